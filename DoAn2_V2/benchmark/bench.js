@@ -0,0 +1,101 @@
+/* Benchmark of one generated DoAn2 topology (see gen_topology.py, which
+ * fills in the @...@ parameters). Follows the mote logs and, once the
+ * simulated time is over, prints a single machine-readable BENCH line:
+ *   pdr          reports received by the coordinator / reports sent, for
+ *                the reports sent up to DRAIN_MS before the end
+ *   lat_*_ms     uplink latency percentiles, send log to coordinator log
+ *   listen_pct, transmit_pct
+ *                mean radio duty cycles over the node reports (Energest)
+ *   joined, join_mean_s, join_max_s
+ *                nodes that sent a report, and when they sent the first
+ *   sixp_success 6P responses received / 6P requests sent */
+
+var SCENARIO = "@SCENARIO@";
+var NODES = @NODES@;
+var SIM_TIME_MS = @SIM_TIME_MS@;
+var DRAIN_MS = 60000;
+
+var sent = {};            // "node:tx" -> send time, us
+var sentCount = 0;
+var receivedCount = 0;
+var latencies = [];
+var firstReport = {};     // node -> time of its first report, us
+var listenSum = 0;
+var transmitSum = 0;
+var dutyCycles = 0;
+var sixpRequests = 0;
+var sixpResponses = 0;
+
+function percentile(sorted, pct) {
+  if(sorted.length == 0) {
+    return -1;
+  }
+  var rank = Math.ceil(sorted.length * pct / 100);
+  return sorted[Math.max(rank, 1) - 1];
+}
+
+function fixed(value, digits) {
+  return value < 0 ? "nan" : value.toFixed(digits);
+}
+
+function report() {
+  var joins = [];
+  for(var node in firstReport) {
+    joins.push(firstReport[node] / 1000000);
+  }
+  var joinSum = 0;
+  var joinMax = -1;
+  for(var i = 0; i < joins.length; i++) {
+    joinSum += joins[i];
+    joinMax = Math.max(joinMax, joins[i]);
+  }
+  latencies.sort(function(a, b) { return a - b; });
+
+  log.log("BENCH scenario=" + SCENARIO +
+          " nodes=" + NODES +
+          " sim_time_s=" + (SIM_TIME_MS / 1000) +
+          " pdr=" + fixed(sentCount > 0 ? receivedCount / sentCount : -1, 4) +
+          " lat_p50_ms=" + fixed(percentile(latencies, 50), 0) +
+          " lat_p90_ms=" + fixed(percentile(latencies, 90), 0) +
+          " lat_p99_ms=" + fixed(percentile(latencies, 99), 0) +
+          " listen_pct=" + fixed(dutyCycles > 0 ? listenSum / dutyCycles : -1, 2) +
+          " transmit_pct=" + fixed(dutyCycles > 0 ? transmitSum / dutyCycles : -1, 2) +
+          " joined=" + joins.length +
+          " join_mean_s=" + fixed(joins.length > 0 ? joinSum / joins.length : -1, 1) +
+          " join_max_s=" + fixed(joinMax, 1) +
+          " sixp_success=" + fixed(sixpRequests > 0 ? sixpResponses / sixpRequests : -1, 4) +
+          "\n");
+}
+
+TIMEOUT(@SIM_TIME_MS@, report(); log.testOK());
+
+while(true) {
+  YIELD();
+  var m;
+  if((m = msg.match(/Node (\d+): Sent data \| TX: (\d+)/)) != null) {
+    if(!(m[1] in firstReport)) {
+      firstReport[m[1]] = time;
+    }
+    if(time < (SIM_TIME_MS - DRAIN_MS) * 1000) {
+      sent[m[1] + ":" + m[2]] = time;
+      sentCount++;
+    }
+    var d = msg.match(/Listen: ([\d.]+)% \| Transmit: ([\d.]+)%/);
+    if(d != null) {
+      listenSum += parseFloat(d[1]);
+      transmitSum += parseFloat(d[2]);
+      dutyCycles++;
+    }
+  } else if((m = msg.match(/Node (\d+) \| TX: (\d+) \|/)) != null) {
+    var key = m[1] + ":" + m[2];
+    if(key in sent) {
+      receivedCount++;
+      latencies.push((time - sent[key]) / 1000);
+      delete sent[key];
+    }
+  } else if(/sf-simple: Send a 6P \w+ Request/.test(msg)) {
+    sixpRequests++;
+  } else if(/sf-simple: Received a 6P \w+ Response/.test(msg)) {
+    sixpResponses++;
+  }
+}
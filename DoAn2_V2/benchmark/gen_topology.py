@@ -0,0 +1,107 @@
+import argparse
+import math
+import os
+import random
+import xml.etree.ElementTree as ET
+
+# Generate a headless Cooja benchmark from test_DoAn2.csc: same coordinator
+# and node mote types, one coordinator (mote 1) and NODES sensor nodes
+# placed as a line, a grid or a random connected cloud, no GUI plugins, and
+# bench.js as the script.
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TEMPLATE = os.path.join(HERE, '..', 'test_DoAn2.csc')
+SCRIPT = os.path.join(HERE, 'bench.js')
+
+# Neighbours are this fraction of the radio range apart
+SPACING = 0.8
+
+
+def line(count, spacing, rng):
+    return [(i * spacing, 0.0) for i in range(1, count + 1)]
+
+
+def grid(count, spacing, rng):
+    # The coordinator takes the corner of the grid
+    side = math.ceil(math.sqrt(count + 1))
+    cells = [(x * spacing, y * spacing) for y in range(side) for x in range(side)]
+    return cells[1:count + 1]
+
+
+def cloud(count, spacing, rng):
+    # Every node lands within range of one placed before it, so the
+    # topology is connected
+    radio_range = spacing / SPACING
+    placed = [(0.0, 0.0)]
+    while len(placed) <= count:
+        x0, y0 = rng.choice(placed)
+        angle = rng.uniform(0, 2 * math.pi)
+        distance = rng.uniform(0.5, 0.9) * radio_range
+        placed.append((x0 + distance * math.cos(angle), y0 + distance * math.sin(angle)))
+    return placed[1:]
+
+
+TOPOLOGIES = {'line': line, 'grid': grid, 'random': cloud}
+
+
+def mote(mote_id, x, y):
+    element = ET.Element('mote')
+    position = ET.SubElement(element, 'interface_config')
+    position.text = '\n          org.contikios.cooja.interfaces.Position\n          '
+    ET.SubElement(position, 'pos', x=f'{x:.2f}', y=f'{y:.2f}').tail = '\n        '
+    identifier = ET.SubElement(element, 'interface_config')
+    identifier.text = '\n          org.contikios.cooja.contikimote.interfaces.ContikiMoteID\n          '
+    ET.SubElement(identifier, 'id').text = str(mote_id)
+    identifier[0].tail = '\n        '
+    return element
+
+
+def generate(topology, nodes, seed, sim_time, output):
+    tree = ET.parse(TEMPLATE)
+    root = tree.getroot()
+    simulation = root.find('simulation')
+    scenario = f'{topology}-{nodes}'
+
+    simulation.find('title').text = f'DoAn2 benchmark {scenario}'
+    simulation.find('randomseed').text = str(seed)
+    simulation.remove(simulation.find('speedlimit'))
+    radio_range = float(simulation.find('radiomedium/transmitting_range').text)
+    positions = TOPOLOGIES[topology](nodes, SPACING * radio_range, random.Random(seed))
+
+    # Sources are found from the directory of the generated file
+    source_dir = os.path.relpath(os.path.dirname(TEMPLATE), os.path.dirname(os.path.abspath(output)))
+    coordinator_type, node_type = simulation.findall('motetype')
+    for motetype in (coordinator_type, node_type):
+        source = motetype.find('source')
+        source.text = source.text.replace('[CONFIG_DIR]', '[CONFIG_DIR]/' + source_dir)
+        for old in motetype.findall('mote'):
+            motetype.remove(old)
+    coordinator_type.append(mote(1, 0.0, 0.0))
+    for i, (x, y) in enumerate(positions):
+        node_type.append(mote(i + 2, x, y))
+
+    for plugin in root.findall('plugin'):
+        root.remove(plugin)
+    with open(SCRIPT) as file:
+        script = file.read()
+    script = script.replace('@SCENARIO@', scenario).replace('@NODES@', str(nodes))
+    script = script.replace('@SIM_TIME_MS@', str(int(sim_time * 1000)))
+    plugin = ET.SubElement(root, 'plugin')
+    plugin.text = '\n    org.contikios.cooja.plugins.ScriptRunner\n    '
+    config = ET.SubElement(plugin, 'plugin_config')
+    ET.SubElement(config, 'script').text = script
+    ET.SubElement(config, 'active').text = 'true'
+
+    ET.indent(tree, space='  ')
+    tree.write(output, encoding='UTF-8', xml_declaration=True)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Generate a DoAn2 benchmark simulation')
+    parser.add_argument('topology', choices=sorted(TOPOLOGIES))
+    parser.add_argument('nodes', type=int, help='sensor nodes, besides the coordinator')
+    parser.add_argument('output', help='.csc file to write')
+    parser.add_argument('--seed', type=int, default=123456)
+    parser.add_argument('--sim-time', type=float, default=1800, help='simulated seconds')
+    args = parser.parse_args()
+    generate(args.topology, args.nodes, args.seed, args.sim_time, args.output)
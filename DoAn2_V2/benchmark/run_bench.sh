@@ -0,0 +1,64 @@
+#!/bin/sh
+# Run the DoAn2 benchmark suite headless in Cooja and collect one BENCH line
+# per scenario into a results file, sorted so that two runs can be diffed:
+#
+#   ./run_bench.sh [results file]       (default: results.txt)
+#
+# Cooja runs are deterministic for a given random seed, so a difference
+# against baseline.txt, printed at the end, comes from the code. To accept
+# new numbers, copy the results over baseline.txt and commit it.
+#
+# Environment:
+#   CONTIKI      Contiki-NG tree (default: ../../../.., as in ../Makefile)
+#   TOPOLOGIES   default: "line grid random"
+#   SIZES        sensor node counts (default: "10 50 100 200")
+#   LINE_SIZES   node counts of the line topology, one hop per node
+#                (default: "10 20")
+#   SIM_TIME     simulated seconds per scenario (default: 1800)
+#   SEED         Cooja random seed (default: 123456)
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+CONTIKI=$(cd "${CONTIKI:-$HERE/../../../..}" && pwd)
+TOPOLOGIES=${TOPOLOGIES:-"line grid random"}
+SIZES=${SIZES:-"10 50 100 200"}
+LINE_SIZES=${LINE_SIZES:-"10 20"}
+SIM_TIME=${SIM_TIME:-1800}
+SEED=${SEED:-123456}
+RESULTS=${1:-$HERE/results.txt}
+WORK=$HERE/out
+
+mkdir -p "$WORK"
+: > "$RESULTS.unsorted"
+
+for topology in $TOPOLOGIES; do
+  sizes=$SIZES
+  if [ "$topology" = line ]; then
+    sizes=$LINE_SIZES
+  fi
+  for nodes in $sizes; do
+    scenario=$topology-$nodes
+    echo "== $scenario"
+    mkdir -p "$WORK/$scenario"
+    python3 "$HERE/gen_topology.py" "$topology" "$nodes" "$WORK/$scenario/$scenario.csc" \
+      --seed "$SEED" --sim-time "$SIM_TIME"
+    rm -f "$WORK/$scenario/COOJA.testlog"
+    "$CONTIKI/tools/cooja/gradlew" --no-watch-fs -p "$CONTIKI/tools/cooja" run \
+      --args="--contiki=$CONTIKI --no-gui --logdir=$WORK/$scenario $WORK/$scenario/$scenario.csc" \
+      > "$WORK/$scenario/cooja.out" 2>&1 || echo "Cooja failed, see $WORK/$scenario/cooja.out"
+    if ! grep -h '^BENCH ' "$WORK/$scenario/COOJA.testlog" >> "$RESULTS.unsorted" 2>/dev/null; then
+      echo "BENCH scenario=$scenario nodes=$nodes failed" >> "$RESULTS.unsorted"
+    fi
+  done
+done
+
+sort "$RESULTS.unsorted" > "$RESULTS"
+rm -f "$RESULTS.unsorted"
+cat "$RESULTS"
+
+if [ -f "$HERE/baseline.txt" ] && [ "$RESULTS" != "$HERE/baseline.txt" ]; then
+  echo "== Against baseline.txt"
+  diff "$HERE/baseline.txt" "$RESULTS" && echo "No change"
+fi
+exit 0
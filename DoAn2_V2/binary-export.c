@@ -0,0 +1,72 @@
+/**
+ * \file
+ *         Binary, CRC-checked record stream over the serial line
+ */
+
+#include "binary-export.h"
+#include "lib/crc16.h"
+
+#include <stdio.h>
+
+static uint16_t seq;
+static uint16_t crc;
+
+/*---------------------------------------------------------------------------*/
+static void
+put_escaped(uint8_t b)
+{
+  if(b == BINARY_EXPORT_FLAG || b == BINARY_EXPORT_ESCAPE) {
+    putchar(BINARY_EXPORT_ESCAPE);
+    b ^= 0x20;
+  }
+  putchar(b);
+}
+/*---------------------------------------------------------------------------*/
+void
+binary_export_begin(uint8_t type)
+{
+  putchar(BINARY_EXPORT_FLAG);
+  crc = 0;
+  binary_export_u8(type);
+  binary_export_u16(seq++);
+}
+
+void
+binary_export_u8(uint8_t v)
+{
+  crc = crc16_add(v, crc);
+  put_escaped(v);
+}
+
+void
+binary_export_u16(uint16_t v)
+{
+  binary_export_u8(v >> 8);
+  binary_export_u8(v & 0xff);
+}
+
+void
+binary_export_u32(uint32_t v)
+{
+  binary_export_u16(v >> 16);
+  binary_export_u16(v & 0xffff);
+}
+
+void
+binary_export_bytes(const uint8_t *p, uint16_t len)
+{
+  while(len-- > 0) {
+    binary_export_u8(*p++);
+  }
+}
+
+void
+binary_export_end(void)
+{
+  uint16_t frame_crc = crc;
+
+  put_escaped(frame_crc >> 8);
+  put_escaped(frame_crc & 0xff);
+  putchar(BINARY_EXPORT_FLAG);
+}
+/*---------------------------------------------------------------------------*/
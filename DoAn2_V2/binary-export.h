@@ -0,0 +1,60 @@
+/**
+ * \file
+ *         Binary, CRC-checked record stream over the serial line
+ *
+ * A frame is delimited by BINARY_EXPORT_FLAG bytes. Inside, a flag or
+ * escape byte is sent as BINARY_EXPORT_ESCAPE followed by the byte XOR
+ * 0x20. The unescaped content is the record type (uint8), a sequence
+ * number (uint16) that lets the host count lost frames, the record body,
+ * and the CRC-16 of all of these (lib/crc16.h, CCITT, initial value 0).
+ * Multi-byte fields are big-endian. Text printed by other modules may
+ * appear between frames; the host skips it.
+ *
+ * Record bodies, as written by the coordinator (decode_export.py reads
+ * them back):
+ *
+ * REPORT, per received report or batch sample: node ID, TX count (uint16),
+ * ASN sent at, ASN received at (uint32), temperature (int16), parent ID,
+ * PINGs sent, PONGs received, RTT in ms (uint16), RSSI (int8), listen and
+ * transmit duty cycles (uint16, TELEMETRY_DUTY_CYCLE_SCALE).
+ *
+ * ROW, per node updated since its previous row: node ID (uint16),
+ * interface identifier (8 bytes), parent ID, TX count (uint16), RX count
+ * (uint32), PRR and PING loss over the window in percent, average PRR,
+ * loss and RTT (uint16, 0xffff if unknown), average RSSI (int8), listen,
+ * transmit, CPU and LPM duty cycles (uint16, 0xffff if unknown).
+ *
+ * GONE, per node dropped from the registry: node ID (uint16), interface
+ * identifier (8 bytes).
+ *
+ * TRACE, per traced message: hop count (uint8), ASN received at (uint32),
+ * then per hop its ID (uint16), ASN (uint32) and queue length (uint8).
+ */
+
+#ifndef BINARY_EXPORT_H_
+#define BINARY_EXPORT_H_
+
+#include "contiki.h"
+
+#define BINARY_EXPORT_FLAG   0x7e
+#define BINARY_EXPORT_ESCAPE 0x7d
+
+/* Record types */
+#define BINARY_EXPORT_REPORT 0x01
+#define BINARY_EXPORT_ROW    0x02
+#define BINARY_EXPORT_GONE   0x03
+#define BINARY_EXPORT_TRACE  0x04
+
+/* Start a frame carrying a record of the given type */
+void binary_export_begin(uint8_t type);
+
+/* Append fields to the record of the current frame */
+void binary_export_u8(uint8_t v);
+void binary_export_u16(uint16_t v);
+void binary_export_u32(uint32_t v);
+void binary_export_bytes(const uint8_t *p, uint16_t len);
+
+/* Close the current frame */
+void binary_export_end(void);
+
+#endif /* BINARY_EXPORT_H_ */
@@ -3,6 +3,10 @@
 #include "net/mac/tsch/tsch.h"
 #include "net/mac/tsch/sixtop/sixtop.h"
 #include "sf-simple.h"
+#include "telemetry.h"
+#include "traffic-class.h"
+#include "window-stats.h"
+#include "binary-export.h"
 #include "sys/log.h"
 #include "net/ipv6/simple-udp.h"
 #include "sys/rtimer.h"
@@ -10,6 +14,8 @@
 #include "net/routing/rpl-lite/rpl.h"
 #include "net/ipv6/uip-debug.h"
 #include "net/nbr-table.h"
+#include "lib/memb.h"
+#include "dev/serial-line.h"
 #include <stdio.h>
 #include "project-conf.h"
 
@@ -19,56 +25,338 @@
 #define LOG_MODULE "Coordinator"
 #define LOG_LEVEL LOG_LEVEL_DBG
 #define UDP_PORT 1234
-#define MAX_NODES 16
 #define CHECK_INTERVAL (CLOCK_SECOND * 5)
 
+/* Node registry: up to MAX_NODES reporting nodes, found by hashing their
+ * IPv6 address into NODE_HASH_BUCKETS chains (a power of two). A node not
+ * heard from for NODE_TIMEOUT is dropped; when the registry is full, the
+ * node heard from least recently makes room for the newcomer. */
+#ifdef COORDINATOR_CONF_MAX_NODES
+#define MAX_NODES COORDINATOR_CONF_MAX_NODES
+#else
+#define MAX_NODES 128
+#endif
+#ifdef COORDINATOR_CONF_NODE_HASH_BUCKETS
+#define NODE_HASH_BUCKETS COORDINATOR_CONF_NODE_HASH_BUCKETS
+#else
+#define NODE_HASH_BUCKETS 64
+#endif
+#ifdef COORDINATOR_CONF_NODE_TIMEOUT
+#define NODE_TIMEOUT COORDINATOR_CONF_NODE_TIMEOUT
+#else
+#define NODE_TIMEOUT (CLOCK_SECOND * 600)
+#endif
+
+/* Uplink latency histograms, from the ASN a report was sent at to the ASN
+ * it arrives at: half-octave buckets of timeslots, exact below 4 slots,
+ * the last bucket taking everything above ~30 s. Counters saturate by
+ * halving the whole histogram, which keeps its shape. Printed on the
+ * "latency" serial command. */
+#define LATENCY_BUCKETS 24
+#define LATENCY_COMMAND "latency"
+
+/* Binary export: instead of text, the serial line carries a framed record
+ * per received report and, every CHECK_INTERVAL, one per node updated
+ * since (see binary-export.h). Switched at run time by the "binary" and
+ * "text" serial commands. */
+#ifdef COORDINATOR_CONF_BINARY_EXPORT
+#define BINARY_EXPORT COORDINATOR_CONF_BINARY_EXPORT
+#else
+#define BINARY_EXPORT 0
+#endif
+#define BINARY_COMMAND "binary"
+#define TEXT_COMMAND "text"
+
+/* Dump of the negotiated cells and their usage (see sf-simple.h) */
+#define CELLS_COMMAND "cells"
+
+/* Duty cycles of a node are averaged over its reports with an exponential
+ * moving average of weight 1/ENERGY_EWMA_DIVISOR */
+#define ENERGY_EWMA_DIVISOR 8
+
 /************************************************
  *                  Structs                     *
  ************************************************/
 /* Structure to hold statistics for each node */
-typedef struct {
+typedef struct node_stats {
+  struct node_stats *next;  // Next node in the same hash bucket
+  clock_time_t last_seen;   // Time of the last report
+  uint16_t node_id;         // Node ID
   uint16_t tx_count;        // Transmission count
-  uint16_t rx_count;        // Reception count
+  uint32_t rx_count;        // Reception count
   uip_ipaddr_t node_addr;   // Node IP address
-  uip_ipaddr_t parent_addr; // Parent IP address
+  uint16_t parent_id;       // Short ID of the parent, 0 if none
   uint16_t ping_sent;       // Total PINGs sent
   uint16_t pong_received;   // Total PONGs received
   uint16_t rtt;             // Round-Trip Time in ms
   int16_t temperature;      // Temperature in Celsius
    int16_t rssi;             // RSSI for received packet
+  uint8_t latency_hist[LATENCY_BUCKETS]; // Uplink latency histogram
+  uint32_t latency_max;     // Largest uplink latency, in timeslots
+  uint16_t energy_reports;  // Reports with duty cycles, saturating
+  uint16_t cpu;             // Average duty cycles, in TELEMETRY_DUTY_CYCLE_SCALE units
+  uint16_t lpm;
+  uint16_t listen;
+  uint16_t transmit;
+  window_stats_t window;    // Recent PRR, loss, RTT and RSSI
+  uint8_t changed;          // Updated since its last exported row
 } node_stats_t;
 
-/* Structure for sensor payload including PING data */
-typedef struct {
-  uint8_t node_id;          // Node ID
-  uint16_t tx_count;        // Transmission count
-  uint16_t rx_count;        // Reception count (PONG received)
-  uint64_t send_time;       // Send time (network uptime ticks)
-  int16_t temperature;      // Temperature in Celsius
-  uip_ipaddr_t parent_addr; // Parent IP address
-  uint16_t ping_sent;       // Total PINGs sent
-  uint16_t pong_received;   // Total PONGs received
-  uint16_t rtt;             // Round-Trip Time in ms
-} sensor_payload_t;
-
 /************************************************
  *              Global variables                *
  ************************************************/
-static node_stats_t node_stats[MAX_NODES];
+MEMB(node_stats_memb, node_stats_t, MAX_NODES);
+static node_stats_t *node_buckets[NODE_HASH_BUCKETS];
 static struct simple_udp_connection udp_conn;
-static int16_t nodes_to_check[] = {4, 15, 88, 171}; // Valid node IDs
+static uint8_t binary_mode = BINARY_EXPORT;
 
 /************************************************
  *                  Functions                   *
  ************************************************/
-/* Map a node ID to a valid index in node_stats */
-static int get_node_index(uint16_t node_id) {
-  for(int i = 0; i < sizeof(nodes_to_check) / sizeof(nodes_to_check[0]); i++) {
-    if(nodes_to_check[i] == node_id) {
-      return i; // Return the index if node_id matches
+/* Hash bucket of a node, from the interface identifier of its address */
+static unsigned node_hash(const uip_ipaddr_t *addr) {
+  unsigned hash = 0;
+  for(int i = 8; i < sizeof(addr->u8); i++) {
+    hash = hash * 31 + addr->u8[i];
+  }
+  return hash & (NODE_HASH_BUCKETS - 1);
+}
+
+/* Find the registry entry of a node, NULL if it is not registered */
+static node_stats_t *node_lookup(const uip_ipaddr_t *addr) {
+  node_stats_t *n;
+  for(n = node_buckets[node_hash(addr)]; n != NULL; n = n->next) {
+    if(uip_ipaddr_cmp(&n->node_addr, addr)) {
+      return n;
+    }
+  }
+  return NULL;
+}
+
+/* Export the record saying a node left the registry */
+static void export_gone(const node_stats_t *node) {
+  binary_export_begin(BINARY_EXPORT_GONE);
+  binary_export_u16(node->node_id);
+  binary_export_bytes(&node->node_addr.u8[8], 8);
+  binary_export_end();
+}
+
+/* Unlink a node from its bucket and release its entry */
+static void node_remove(node_stats_t *node) {
+  node_stats_t **p;
+  if(binary_mode) {
+    export_gone(node);
+  }
+  for(p = &node_buckets[node_hash(&node->node_addr)]; *p != NULL; p = &(*p)->next) {
+    if(*p == node) {
+      *p = node->next;
+      memb_free(&node_stats_memb, node);
+      return;
+    }
+  }
+}
+
+/* Drop the node heard from least recently; only done when the registry is full */
+static void node_evict_oldest(void) {
+  node_stats_t *oldest = NULL;
+  node_stats_t *n;
+  for(int i = 0; i < NODE_HASH_BUCKETS; i++) {
+    for(n = node_buckets[i]; n != NULL; n = n->next) {
+      if(oldest == NULL ||
+         clock_time() - n->last_seen > clock_time() - oldest->last_seen) {
+        oldest = n;
+      }
+    }
+  }
+  if(oldest != NULL) {
+    LOG_WARN("Registry full, evicting node %u\r\n", oldest->node_id);
+    node_remove(oldest);
+  }
+}
+
+/* Find or create the registry entry of a node */
+static node_stats_t *node_register(const uip_ipaddr_t *addr) {
+  node_stats_t *node = node_lookup(addr);
+  if(node != NULL) {
+    return node;
+  }
+  if((node = memb_alloc(&node_stats_memb)) == NULL) {
+    node_evict_oldest();
+    if((node = memb_alloc(&node_stats_memb)) == NULL) {
+      return NULL;
+    }
+  }
+  memset(node, 0, sizeof(*node));
+  window_stats_init(&node->window);
+  uip_ipaddr_copy(&node->node_addr, addr);
+  unsigned bucket = node_hash(addr);
+  node->next = node_buckets[bucket];
+  node_buckets[bucket] = node;
+  return node;
+}
+
+/* Drop the nodes which stopped reporting */
+static void node_age_out(void) {
+  node_stats_t *n;
+  node_stats_t *next;
+  for(int i = 0; i < NODE_HASH_BUCKETS; i++) {
+    for(n = node_buckets[i]; n != NULL; n = next) {
+      next = n->next;
+      if(clock_time() - n->last_seen > NODE_TIMEOUT) {
+        if(!binary_mode) {
+          LOG_INFO("Node %u timed out\r\n", n->node_id);
+        }
+        node_remove(n);
+      }
+    }
+  }
+}
+
+/* Histogram bucket of a latency, in timeslots */
+static int latency_bucket(uint32_t slots) {
+  if(slots < 4) {
+    return slots;
+  }
+  int octave = 31 - __builtin_clz(slots);
+  int bucket = 2 * octave + ((slots >> (octave - 1)) & 1);
+  return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+/* Smallest latency falling in a bucket, in timeslots */
+static uint32_t latency_bucket_floor(int bucket) {
+  if(bucket < 4) {
+    return bucket;
+  }
+  return (1UL << (bucket / 2)) + (bucket % 2) * (1UL << (bucket / 2 - 1));
+}
+
+static uint32_t slots_to_ms(uint32_t slots) {
+  return (uint64_t)slots * TSCH_DEFAULT_TIMESLOT_LENGTH / 1000;
+}
+
+static void latency_record(node_stats_t *node, uint32_t slots) {
+  int bucket = latency_bucket(slots);
+  if(node->latency_hist[bucket] == 0xff) {
+    for(int i = 0; i < LATENCY_BUCKETS; i++) {
+      node->latency_hist[i] /= 2;
+    }
+  }
+  node->latency_hist[bucket]++;
+  if(slots > node->latency_max) {
+    node->latency_max = slots;
+  }
+}
+
+/* Upper bound of the pct-th percentile, in timeslots */
+static uint32_t latency_percentile(const node_stats_t *node, int pct) {
+  uint32_t total = 0;
+  uint32_t sum = 0;
+  int i;
+  for(i = 0; i < LATENCY_BUCKETS; i++) {
+    total += node->latency_hist[i];
+  }
+  for(i = 0; i < LATENCY_BUCKETS - 1; i++) {
+    sum += node->latency_hist[i];
+    if(sum * 100 >= total * pct) {
+      break;
+    }
+  }
+  if(i == LATENCY_BUCKETS - 1) {
+    return node->latency_max;
+  }
+  return MIN(latency_bucket_floor(i + 1) - 1, node->latency_max);
+}
+
+/* Function to print the uplink latency of every node */
+static void print_latency() {
+  printf("Uplink latency (ms):\r\n");
+  for(int i = 0; i < NODE_HASH_BUCKETS; i++) {
+    for(node_stats_t *n = node_buckets[i]; n != NULL; n = n->next) {
+      if(n->latency_max == 0) {
+        continue;
+      }
+      printf("Node ID %u | p50: %lu | p95: %lu | p99: %lu | max: %lu\r\n",
+             n->node_id,
+             (unsigned long)slots_to_ms(latency_percentile(n, 50)),
+             (unsigned long)slots_to_ms(latency_percentile(n, 95)),
+             (unsigned long)slots_to_ms(latency_percentile(n, 99)),
+             (unsigned long)slots_to_ms(n->latency_max));
     }
   }
-  return -1; // Return -1 if node_id is not valid
+}
+
+/* Print where the time went along the path of a traced message: a hop
+ * accounts from its record (queued for the next hop) to the record of the
+ * next hop, or to the arrival here for the last one; that is queueing plus
+ * every transmission attempt over the link */
+static void print_trace(const telemetry_hop_t *hops, int count) {
+  if(binary_mode) {
+    binary_export_begin(BINARY_EXPORT_TRACE);
+    binary_export_u8(count);
+    binary_export_u32(tsch_current_asn.ls4b);
+    for(int i = 0; i < count; i++) {
+      binary_export_u16(hops[i].id);
+      binary_export_u32(hops[i].asn);
+      binary_export_u8(hops[i].queue);
+    }
+    binary_export_end();
+    return;
+  }
+
+  LOG_INFO("Trace from node %u:", hops[0].id);
+  for(int i = 0; i < count; i++) {
+    uint32_t next = (i + 1 < count) ? hops[i + 1].asn : tsch_current_asn.ls4b;
+    LOG_INFO_(" %u (queue %u) +%lu ms ->", hops[i].id, hops[i].queue,
+              (unsigned long)slots_to_ms(next - hops[i].asn));
+  }
+  LOG_INFO_(" root\r\n");
+}
+
+/* One step of the moving average of a duty cycle */
+static uint16_t energy_average(uint16_t average, uint16_t sample, int first) {
+  if(first) {
+    return sample;
+  }
+  return average + ((int32_t)sample - average) / ENERGY_EWMA_DIVISOR;
+}
+
+/* Account the duty cycles of a report to its node, if it carries them */
+static void energy_record(node_stats_t *node, const telemetry_sensor_t *report) {
+  if(report->cpu == TELEMETRY_DUTY_CYCLE_UNKNOWN) {
+    return;
+  }
+  int first = node->energy_reports == 0;
+  node->cpu = energy_average(node->cpu, report->cpu, first);
+  node->lpm = energy_average(node->lpm, report->lpm, first);
+  node->listen = energy_average(node->listen, report->listen, first);
+  node->transmit = energy_average(node->transmit, report->transmit, first);
+  if(node->energy_reports < 0xffff) {
+    node->energy_reports++;
+  }
+}
+
+/* Print a duty cycle as a percentage */
+static void print_duty_cycle(const char *name, uint16_t duty_cycle) {
+  printf(" | %s: %u.%02u%%", name, duty_cycle / 100, duty_cycle % 100);
+}
+
+/* Print a ratio over the window of recent reports */
+static void print_ratio(const char *name, uint16_t ratio) {
+  if(ratio == WINDOW_STATS_UNKNOWN) {
+    printf(" | %s: n/a", name);
+  } else {
+    printf(" | %s: %u%%", name, ratio);
+  }
+}
+
+/* Print a moving average of the node statistics, if it has a sample */
+static void print_average(const char *name, int32_t average, const char *unit,
+                          int valid) {
+  if(valid) {
+    printf(" | %s: %d%s", name, WINDOW_STATS_AVERAGE(average), unit);
+  } else {
+    printf(" | %s: n/a", name);
+  }
 }
 
 /* Function to print routing table and node statistics */
@@ -82,38 +370,155 @@ static void print_routing_table() {
     printf("Coordinator address unavailable.\r\n");
   }
 
-  for(int j = 0; j < sizeof(nodes_to_check) / sizeof(nodes_to_check[0]); j++) {
-    int node_id = nodes_to_check[j];
-    int index = get_node_index(node_id);
-    if(index >= 0 && node_stats[index].rx_count > 0) {
-      printf("Node ID %d [", node_id);
-      uip_debug_ipaddr_print(&node_stats[index].node_addr);
-      printf("] via ");
-      if(uip_is_addr_unspecified(&node_stats[index].parent_addr)) {
-        printf("root");
+  node_age_out();
+
+  for(int i = 0; i < NODE_HASH_BUCKETS; i++) {
+    for(node_stats_t *n = node_buckets[i]; n != NULL; n = n->next) {
+      printf("Node ID %u [", n->node_id);
+      uip_debug_ipaddr_print(&n->node_addr);
+      if(n->parent_id == 0) {
+        printf("] via none");
       } else {
-        uip_debug_ipaddr_print(&node_stats[index].parent_addr);
+        printf("] via %u", n->parent_id);
       }
 
-      int packet_loss = (node_stats[index].ping_sent > 0) ? 
-                  (int)((1.0 - ((float)node_stats[index].pong_received / node_stats[index].ping_sent)) * 100) : 100;
+      printf(" | TX: %u | RX: %lu", n->tx_count, (unsigned long)n->rx_count);
+      print_ratio("PRR", window_stats_prr(&n->window));
+      printf(" | Temp: %dC | RSSI: %d | PING Sent: %u | PONG Received: %u",
+             n->temperature,
+             n->rssi,
+             n->ping_sent,
+             n->pong_received);
+      print_ratio("Packet Loss", window_stats_loss(&n->window));
+      printf(" | RTT: %u ms\r\n", n->rtt);
 
+      printf("  Average:");
+      print_average("PRR", n->window.prr, "%", 1);
+      print_average("Loss", n->window.loss, "%", n->window.loss >= 0);
+      print_average("RTT", n->window.rtt, " ms", n->window.rtt >= 0);
+      print_average("RSSI", n->window.rssi, " dBm", 1);
+      printf("\r\n");
+      if(n->energy_reports > 0) {
+        printf("  Energy:");
+        print_duty_cycle("Listen", n->listen);
+        print_duty_cycle("Transmit", n->transmit);
+        print_duty_cycle("CPU", n->cpu);
+        print_duty_cycle("LPM", n->lpm);
+        printf(" | Reports: %u\r\n", n->energy_reports);
+      }
+    }
+  }
+}
 
-      printf(" | TX: %u | RX: %u | PRR: %d%% | Temp: %dC | RSSI: %d | PING Sent: %u | PONG Received: %u | Packet Loss: %d%% | RTT: %u ms\r\n",
-             node_stats[index].tx_count,
-             node_stats[index].rx_count,
-             (node_stats[index].tx_count > 0) ? 
-               (int)((float)node_stats[index].rx_count / node_stats[index].tx_count * 100) : 0,
-             node_stats[index].temperature,
-             node_stats[index].rssi,
-             node_stats[index].ping_sent,
-             node_stats[index].pong_received,
-             packet_loss,
-             node_stats[index].rtt);
+/* Average for export, 0xffff if there is none */
+static uint16_t export_average(int32_t average, int valid) {
+  return valid ? (uint16_t)WINDOW_STATS_AVERAGE(average) : 0xffff;
+}
+
+/* Export the rows of the nodes updated since their previous row, the
+ * binary counterpart of print_routing_table() */
+static void export_changed_rows() {
+  node_age_out();
+
+  for(int i = 0; i < NODE_HASH_BUCKETS; i++) {
+    for(node_stats_t *n = node_buckets[i]; n != NULL; n = n->next) {
+      if(!n->changed) {
+        continue;
+      }
+      n->changed = 0;
+      int energy = n->energy_reports > 0;
+      binary_export_begin(BINARY_EXPORT_ROW);
+      binary_export_u16(n->node_id);
+      binary_export_bytes(&n->node_addr.u8[8], 8);
+      binary_export_u16(n->parent_id);
+      binary_export_u16(n->tx_count);
+      binary_export_u32(n->rx_count);
+      binary_export_u16(window_stats_prr(&n->window));
+      binary_export_u16(window_stats_loss(&n->window));
+      binary_export_u16(export_average(n->window.prr, 1));
+      binary_export_u16(export_average(n->window.loss, n->window.loss >= 0));
+      binary_export_u16(export_average(n->window.rtt, n->window.rtt >= 0));
+      binary_export_u8((int8_t)WINDOW_STATS_AVERAGE(n->window.rssi));
+      binary_export_u16(energy ? n->listen : 0xffff);
+      binary_export_u16(energy ? n->transmit : 0xffff);
+      binary_export_u16(energy ? n->cpu : 0xffff);
+      binary_export_u16(energy ? n->lpm : 0xffff);
+      binary_export_end();
     }
   }
 }
 
+/* Export the record of one received report */
+static void export_report(const telemetry_sensor_t *report, int16_t rssi) {
+  binary_export_begin(BINARY_EXPORT_REPORT);
+  binary_export_u16(report->node_id);
+  binary_export_u16(report->tx_count);
+  binary_export_u32(report->asn);
+  binary_export_u32(tsch_current_asn.ls4b);
+  binary_export_u16((uint16_t)report->temperature);
+  binary_export_u16(report->parent_id);
+  binary_export_u16(report->ping_sent);
+  binary_export_u16(report->pong_received);
+  binary_export_u16(report->rtt);
+  binary_export_u8((int8_t)rssi);
+  binary_export_u16(report->listen);
+  binary_export_u16(report->transmit);
+  binary_export_end();
+}
+
+/* Account one sensor report (or one sample of a batch) to its node; the
+ * latency of batched samples includes their wait in the batch, so it is
+ * only recorded for reports sent on their own */
+static void handle_report(const uip_ipaddr_t *sender_addr,
+                          const telemetry_sensor_t *received_data,
+                          int record_latency) {
+  node_stats_t *node = node_register(sender_addr);
+  if(node == NULL) {
+    LOG_ERR("No registry entry for node %u\r\n", received_data->node_id);
+    return;
+  }
+
+  /* Update node statistics */
+  node->last_seen = clock_time();
+  node->node_id = received_data->node_id;
+  node->tx_count = received_data->tx_count;
+  node->rx_count++;
+  node->temperature = received_data->temperature;
+  node->ping_sent = received_data->ping_sent;
+  node->pong_received = received_data->pong_received;
+  node->rtt = received_data->rtt;
+  node->parent_id = received_data->parent_id;
+  energy_record(node, received_data);
+
+  /* Get RSSI of received packet */
+  node->rssi = packetbuf_attr(PACKETBUF_ATTR_RSSI);
+  window_stats_update(&node->window, received_data, node->rssi);
+
+  /* All nodes share the ASN, so this is the exact one-way latency */
+  uint32_t latency = tsch_current_asn.ls4b - received_data->asn;
+  if(record_latency && latency < 0x80000000UL) {
+    latency_record(node, latency);
+  }
+
+  node->changed = 1;
+  if(binary_mode) {
+    export_report(received_data, node->rssi);
+    return;
+  }
+
+  /* Log sensor data and PING data */
+  LOG_INFO("Node %u | TX: %u | RX: %lu | PRR: %d%% | Temp: %dC | RSSI: %d | PING Sent: %u | PONG Received: %u | RTT: %u ms\r\n",
+           received_data->node_id,
+           received_data->tx_count,
+           (unsigned long)node->rx_count,
+           WINDOW_STATS_AVERAGE(node->window.prr),
+           received_data->temperature,
+           node->rssi,
+           received_data->ping_sent,
+           received_data->pong_received,
+           received_data->rtt);
+}
+
 /* UDP receive callback function */
 static void udp_rx_callback(struct simple_udp_connection *c,
                             const uip_ipaddr_t *sender_addr,
@@ -122,58 +527,59 @@ static void udp_rx_callback(struct simple_udp_connection *c,
                             uint16_t receiver_port,
                             const uint8_t *data,
                             uint16_t datalen) {
-  /* Check if the message is a PING request */
-  if(datalen >= 1 && data[0] == 'P') { // 'P' denotes a PING message
-    char pong_msg[] = "PONG";
-    simple_udp_sendto(&udp_conn, pong_msg, sizeof(pong_msg), sender_addr);
-
-    LOG_INFO("PONG sent to Node ");
-    uip_debug_ipaddr_print(sender_addr);
-    LOG_INFO_("\r\n");
+  /* Take the per-hop trace off the message, if it collected one */
+  telemetry_hop_t hops[TELEMETRY_TRACE_MAX_HOPS];
+  int hop_count = telemetry_trace_strip(hops, TELEMETRY_TRACE_MAX_HOPS, data, &datalen);
+  if(hop_count < 0) {
+    LOG_ERR("Malformed trace: %u bytes\r\n", datalen);
     return;
   }
+  if(hop_count > 0) {
+    print_trace(hops, hop_count);
+  }
 
-  /* Check if the message is a sensor_payload_t */
-  if(datalen == sizeof(sensor_payload_t)) {
-    sensor_payload_t received_data;
-    memcpy(&received_data, data, sizeof(sensor_payload_t));
-
-    int index = get_node_index(received_data.node_id);
-    if(index < 0) {
-      LOG_ERR("Invalid node ID %u\r\n", received_data.node_id);
+  /* Check if the message is a PING request: echo it back as a PONG */
+  if(telemetry_type(data, datalen) == TELEMETRY_TYPE_PING) {
+    telemetry_probe_t probe;
+    uint8_t pong[TELEMETRY_PROBE_LEN];
+    if(telemetry_probe_decode(TELEMETRY_TYPE_PING, &probe, data, datalen) < 0) {
+      LOG_ERR("Malformed PING: %u bytes\r\n", datalen);
       return;
     }
+    int len = telemetry_probe_encode(TELEMETRY_TYPE_PONG, &probe, pong, sizeof(pong));
+    simple_udp_sendto(&udp_conn, pong, len, sender_addr);
 
-    /* Update node statistics */
-    node_stats[index].tx_count = received_data.tx_count;
-    node_stats[index].rx_count++;
-    node_stats[index].temperature = received_data.temperature;
-    node_stats[index].ping_sent = received_data.ping_sent;
-    node_stats[index].pong_received = received_data.pong_received;
-    node_stats[index].rtt = received_data.rtt;
-    uip_ipaddr_copy(&node_stats[index].node_addr, sender_addr);
-    uip_ipaddr_copy(&node_stats[index].parent_addr, &received_data.parent_addr);
-
-    /* Get RSSI of received packet */
-    node_stats[index].rssi = packetbuf_attr(PACKETBUF_ATTR_RSSI);
-
-    /* Calculate Packet Reception Ratio (PRR) */
-    int prr = (node_stats[index].tx_count > 0) ? 
-              (int)((float)node_stats[index].rx_count / node_stats[index].tx_count * 100) : 0;
-
-    /* Log sensor data and PING data */
-    LOG_INFO("Node %u | TX: %u | RX: %u | PRR: %d%% | Temp: %dC | RSSI: %d | PING Sent: %u | PONG Received: %u | RTT: %u ms\r\n",
-             received_data.node_id,
-             received_data.tx_count,
-             node_stats[index].rx_count,
-             prr,
-             received_data.temperature,
-             node_stats[index].rssi,
-             received_data.ping_sent,
-             received_data.pong_received,
-             received_data.rtt);
+    if(!binary_mode) {
+      LOG_INFO("PONG %u sent to Node ", probe.seq);
+      uip_debug_ipaddr_print(sender_addr);
+      LOG_INFO_("\r\n");
+    }
+    return;
+  }
+
+  /* Check if the message is a sensor report */
+  if(telemetry_type(data, datalen) == TELEMETRY_TYPE_SENSOR) {
+    telemetry_sensor_t received_data;
+    if(telemetry_sensor_decode(&received_data, data, datalen) < 0) {
+      LOG_ERR("Malformed sensor report: %u bytes\r\n", datalen);
+      return;
+    }
+    handle_report(sender_addr, &received_data, 1);
+  } else if(telemetry_type(data, datalen) == TELEMETRY_TYPE_BATCH) {
+    static telemetry_sensor_t batch[TELEMETRY_BATCH_MAX];
+    int count = telemetry_batch_decode(batch, TELEMETRY_BATCH_MAX, data, datalen);
+    if(count < 0) {
+      LOG_ERR("Malformed sensor batch: %u bytes\r\n", datalen);
+      return;
+    }
+    if(!binary_mode) {
+      LOG_INFO("Batch of %d samples from node %u\r\n", count, batch[0].node_id);
+    }
+    for(int i = 0; i < count; i++) {
+      handle_report(sender_addr, &batch[i], 0);
+    }
   } else {
-    LOG_ERR("Received packet with unexpected size: %u bytes\r\n", datalen);
+    LOG_ERR("Received unknown packet: %u bytes\r\n", datalen);
   }
 }
 
@@ -188,12 +594,14 @@ PROCESS_THREAD(coordinator_process, ev, data) {
   PROCESS_BEGIN();
 
   LOG_INFO("Starting coordinator node...\r\n");
+  memb_init(&node_stats_memb);
   NETSTACK_ROUTING.root_start();
   sixtop_add_sf(&sf_simple_driver);
   NETSTACK_MAC.on();
 
   /* Register UDP connection */
   simple_udp_register(&udp_conn, UDP_PORT, NULL, UDP_PORT, udp_rx_callback);
+  traffic_class_init(UDP_PORT);
 
   /* Set timer for periodic checks */
   etimer_set(&timer, CHECK_INTERVAL);
@@ -201,9 +609,31 @@ PROCESS_THREAD(coordinator_process, ev, data) {
     PROCESS_YIELD();
 
     if(etimer_expired(&timer)) {
-      print_routing_table();
+      if(binary_mode) {
+        export_changed_rows();
+      } else {
+        print_routing_table();
+      }
       etimer_reset(&timer);
     }
+
+    if(ev == serial_line_event_message) {
+      if(strcmp((const char *)data, LATENCY_COMMAND) == 0) {
+        print_latency();
+      } else if(strcmp((const char *)data, BINARY_COMMAND) == 0) {
+        /* Start the host off with the whole table */
+        for(int i = 0; i < NODE_HASH_BUCKETS; i++) {
+          for(node_stats_t *n = node_buckets[i]; n != NULL; n = n->next) {
+            n->changed = 1;
+          }
+        }
+        binary_mode = 1;
+      } else if(strcmp((const char *)data, TEXT_COMMAND) == 0) {
+        binary_mode = 0;
+      } else if(strcmp((const char *)data, CELLS_COMMAND) == 0) {
+        sf_simple_print_cells();
+      }
+    }
   }
 
   PROCESS_END();
@@ -0,0 +1,134 @@
+import struct
+import sys
+
+# Framing and records of binary-export.h
+FLAG = 0x7e
+ESCAPE = 0x7d
+
+REPORT = 0x01
+ROW = 0x02
+GONE = 0x03
+TRACE = 0x04
+
+REPORT_FORMAT = '>HHIIhHHHHbHH'
+ROW_FORMAT = '>H8sHHIHHHHHbHHHH'
+GONE_FORMAT = '>H8s'
+HOP_FORMAT = '>HIB'
+
+UNKNOWN = 0xffff
+TIMESLOT_MS = 10
+
+
+def crc16_add(b, acc):
+    # lib/crc16.c of Contiki-NG
+    acc ^= b
+    acc = ((acc >> 8) | (acc << 8)) & 0xffff
+    acc ^= (acc & 0xff00) << 4
+    acc &= 0xffff
+    acc ^= (acc >> 8) >> 4
+    acc ^= (acc & 0xff00) >> 5
+    return acc
+
+
+def crc16(data):
+    acc = 0
+    for b in data:
+        acc = crc16_add(b, acc)
+    return acc
+
+
+def read_frames(stream):
+    # Yield the unescaped content of the frames with a valid CRC, skipping
+    # whatever text comes between them
+    frame = None
+    escaped = False
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            return
+        for b in chunk:
+            if b == FLAG:
+                if frame is not None and len(frame) >= 5 and \
+                        crc16(frame[:-2]) == (frame[-2] << 8 | frame[-1]):
+                    yield bytes(frame[:-2])
+                    frame = None
+                else:
+                    frame = bytearray()
+                escaped = False
+            elif frame is None:
+                continue
+            elif b == ESCAPE:
+                escaped = True
+            else:
+                frame.append(b ^ 0x20 if escaped else b)
+                escaped = False
+
+
+def percent(value):
+    return 'n/a' if value == UNKNOWN else f'{value}%'
+
+
+def duty_cycle(value):
+    return 'n/a' if value == UNKNOWN else f'{value / 100:.2f}%'
+
+
+def format_record(kind, body):
+    if kind == REPORT:
+        (node_id, tx, sent_asn, recv_asn, temp, parent, ping_sent, pong_received,
+         rtt, rssi, listen, transmit) = struct.unpack(REPORT_FORMAT, body[:struct.calcsize(REPORT_FORMAT)])
+        latency = ((recv_asn - sent_asn) & 0xffffffff) * TIMESLOT_MS
+        return (f"Node {node_id} | TX: {tx} | Temp: {temp}C | Parent: {parent} | RSSI: {rssi} | "
+                f"PING Sent: {ping_sent} | PONG Received: {pong_received} | RTT: {rtt} ms | "
+                f"Latency: {latency} ms | Listen: {duty_cycle(listen)} | Transmit: {duty_cycle(transmit)}")
+    if kind == ROW:
+        (node_id, iid, parent, tx, rx, prr, loss, avg_prr, avg_loss, avg_rtt, avg_rssi,
+         listen, transmit, cpu, lpm) = struct.unpack(ROW_FORMAT, body[:struct.calcsize(ROW_FORMAT)])
+        rtt = 'n/a' if avg_rtt == UNKNOWN else f'{avg_rtt} ms'
+        return (f"Node ID {node_id} [{iid.hex()}] via {parent or 'none'} | TX: {tx} | RX: {rx} | "
+                f"PRR: {percent(prr)} | Packet Loss: {percent(loss)} | Average PRR: {percent(avg_prr)} | "
+                f"Loss: {percent(avg_loss)} | RTT: {rtt} | RSSI: {avg_rssi} dBm | "
+                f"Listen: {duty_cycle(listen)} | Transmit: {duty_cycle(transmit)} | "
+                f"CPU: {duty_cycle(cpu)} | LPM: {duty_cycle(lpm)}")
+    if kind == GONE:
+        node_id, iid = struct.unpack(GONE_FORMAT, body[:struct.calcsize(GONE_FORMAT)])
+        return f"Node {node_id} [{iid.hex()}] timed out"
+    if kind == TRACE:
+        count, recv_asn = struct.unpack('>BI', body[:5])
+        hops = [struct.unpack_from(HOP_FORMAT, body, 5 + i * struct.calcsize(HOP_FORMAT))
+                for i in range(count)]
+        text = f"Trace from node {hops[0][0]}:" if hops else "Trace:"
+        for i, (hop_id, asn, queue) in enumerate(hops):
+            following = hops[i + 1][1] if i + 1 < count else recv_asn
+            text += f" {hop_id} (queue {queue}) +{((following - asn) & 0xffffffff) * TIMESLOT_MS} ms ->"
+        return text + " root"
+    return f"Unknown record type {kind}: {body.hex()}"
+
+
+def decode_stream(stream):
+    expected = None
+    lost = 0
+    for frame in read_frames(stream):
+        kind, seq = struct.unpack('>BH', frame[:3])
+        if expected is not None and seq != expected:
+            lost += (seq - expected) & 0xffff
+            print(f"-- {(seq - expected) & 0xffff} frame(s) lost, {lost} so far")
+        expected = (seq + 1) & 0xffff
+        try:
+            print(format_record(kind, frame[3:]))
+        except struct.error:
+            print(f"Truncated record type {kind}: {frame[3:].hex()}")
+
+
+# Example usage: python decode_export.py putty.log, or - for the standard input
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        print(f"Usage: {sys.argv[0]} <capture file | ->")
+        sys.exit(1)
+    if sys.argv[1] == '-':
+        decode_stream(sys.stdin.buffer)
+    else:
+        try:
+            with open(sys.argv[1], 'rb') as file:
+                decode_stream(file)
+        except FileNotFoundError:
+            print(f"Error: File not found: {sys.argv[1]}")
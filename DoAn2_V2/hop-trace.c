@@ -0,0 +1,112 @@
+/**
+ * \file
+ *         In-band per-hop tracing of telemetry messages
+ *
+ * The IP output hook sees the uncompressed IPv6 packet of every datagram
+ * this node sends or forwards, before 6LoWPAN compression and before TSCH
+ * queues it. The record goes just before the trailing record count, and
+ * the IPv6 and UDP lengths and the UDP checksum are updated to match.
+ */
+
+#include "hop-trace.h"
+#include "telemetry.h"
+#include "net/netstack.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uipbuf.h"
+#include "net/mac/tsch/tsch.h"
+
+static uint16_t trace_port;
+
+/*---------------------------------------------------------------------------*/
+static uint32_t
+sum_bytes(uint32_t sum, const uint8_t *p, uint16_t len)
+{
+  while(len > 1) {
+    sum += ((uint16_t)p[0] << 8) | p[1];
+    p += 2;
+    len -= 2;
+  }
+  if(len > 0) {
+    sum += (uint16_t)p[0] << 8;
+  }
+  return sum;
+}
+
+/* UDP checksum over the pseudo-header and the whole datagram */
+static uint16_t
+udp_checksum(const struct uip_udp_hdr *udp, uint16_t udp_len)
+{
+  uint32_t sum = udp_len + UIP_PROTO_UDP;
+
+  sum = sum_bytes(sum, (const uint8_t *)&UIP_IP_BUF->srcipaddr,
+                  2 * sizeof(uip_ipaddr_t));
+  sum = sum_bytes(sum, (const uint8_t *)udp, udp_len);
+  while(sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  sum = ~sum & 0xffff;
+  return sum == 0 ? 0xffff : sum;
+}
+/*---------------------------------------------------------------------------*/
+static enum netstack_ip_action
+trace_output(const linkaddr_t *localdest)
+{
+  struct uip_udp_hdr *udp;
+  struct tsch_neighbor *n;
+  telemetry_hop_t hop;
+  uint8_t protocol;
+  uint8_t *payload;
+  uint16_t payload_len;
+  uint16_t udp_len;
+  uint8_t count;
+
+  udp = (struct uip_udp_hdr *)uipbuf_get_last_header(uip_buf, uip_len,
+                                                     &protocol);
+  if(udp == NULL || protocol != UIP_PROTO_UDP ||
+     udp->destport != UIP_HTONS(trace_port)) {
+    return NETSTACK_IP_PROCESS;
+  }
+
+  payload = (uint8_t *)udp + UIP_UDPH_LEN;
+  payload_len = uip_buf + uip_len - payload;
+  if(payload_len < TELEMETRY_HEADER_LEN + 1 ||
+     !(payload[0] & TELEMETRY_FLAG_TRACE)) {
+    return NETSTACK_IP_PROCESS;
+  }
+
+  count = payload[payload_len - 1];
+  if(count >= TELEMETRY_TRACE_MAX_HOPS ||
+     uip_len + TELEMETRY_HOP_LEN > UIP_BUFSIZE) {
+    /* forwarded as it is */
+    return NETSTACK_IP_PROCESS;
+  }
+
+  hop.id = ((uint16_t)linkaddr_node_addr.u8[LINKADDR_SIZE - 2] << 8) |
+    linkaddr_node_addr.u8[LINKADDR_SIZE - 1];
+  hop.asn = tsch_current_asn.ls4b;
+  n = localdest != NULL ? tsch_queue_get_nbr(localdest) : NULL;
+  hop.queue = n != NULL ? MIN(tsch_queue_nbr_packet_count(n), 0xff) : 0;
+  telemetry_hop_encode(&hop, &payload[payload_len - 1]);
+  payload[payload_len - 1 + TELEMETRY_HOP_LEN] = count + 1;
+
+  uip_len += TELEMETRY_HOP_LEN;
+  uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+  udp_len = uip_buf + uip_len - (uint8_t *)udp;
+  udp->udplen = UIP_HTONS(udp_len);
+  udp->udpchksum = 0;
+  udp->udpchksum = UIP_HTONS(udp_checksum(udp, udp_len));
+  return NETSTACK_IP_PROCESS;
+}
+
+static struct netstack_ip_packet_processor trace_processor = {
+  .process_input = NULL,
+  .process_output = trace_output
+};
+/*---------------------------------------------------------------------------*/
+void
+hop_trace_init(uint16_t port)
+{
+  trace_port = port;
+  netstack_ip_packet_processor_add(&trace_processor);
+}
+/*---------------------------------------------------------------------------*/
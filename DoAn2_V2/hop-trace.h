@@ -0,0 +1,18 @@
+/**
+ * \file
+ *         In-band per-hop tracing of telemetry messages
+ *
+ * Every node of the path appends a hop record to the UDP messages to the
+ * telemetry port which carry TELEMETRY_FLAG_TRACE, as they leave the IPv6
+ * layer; see telemetry.h for the record format.
+ */
+
+#ifndef HOP_TRACE_H_
+#define HOP_TRACE_H_
+
+#include "contiki.h"
+
+/* Start tracing the messages to the given UDP port */
+void hop_trace_init(uint16_t port);
+
+#endif /* HOP_TRACE_H_ */
@@ -3,14 +3,21 @@
 #include "net/routing/routing.h"
 #include "net/mac/tsch/sixtop/sixtop.h"
 #include "sf-simple.h"
+#include "telemetry.h"
+#include "hop-trace.h"
+#include "traffic-class.h"
 #include "sys/log.h"
 #include "sys/node-id.h"
 #include "net/ipv6/simple-udp.h"
 #include "sys/rtimer.h"
 #include "net/routing/rpl-lite/rpl.h"
 #include "net/ipv6/uip-debug.h"
+#include "sys/energest.h"
+#include "net/link-stats.h"
+#include "dev/serial-line.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "project-conf.h"
 
 /************************************************
@@ -21,39 +28,156 @@
 #define UDP_PORT 1234
 #define CHECK_INTERVAL (CLOCK_SECOND * 5)
 #define PING_INTERVAL (CLOCK_SECOND * 4)
+
+/* PING probes awaiting their PONG; a probe not answered within
+ * NODE_PING_TIMEOUT, or pushed out of a full table, counts as lost */
+#ifdef NODE_CONF_PINGS_IN_FLIGHT
+#define NODE_PINGS_IN_FLIGHT NODE_CONF_PINGS_IN_FLIGHT
+#else
+#define NODE_PINGS_IN_FLIGHT 4
+#endif
+#ifdef NODE_CONF_PING_TIMEOUT
+#define NODE_PING_TIMEOUT NODE_CONF_PING_TIMEOUT
+#else
+#define NODE_PING_TIMEOUT (CLOCK_SECOND * 8)
+#endif
+#define SEND_INTERVAL (CLOCK_SECOND * 10)
+
+/* Dump of the negotiated cells and their usage (see sf-simple.h) */
+#define CELLS_COMMAND "cells"
+
+/* Stepped traffic profile (test_DoAn2_adaptive.csc): the report interval
+ * walks through traffic_steps[], one step every TRAFFIC_STEP_DURATION */
+#ifdef NODE_CONF_TRAFFIC_STEPS
+#define NODE_TRAFFIC_STEPS NODE_CONF_TRAFFIC_STEPS
+#else
+#define NODE_TRAFFIC_STEPS 0
+#endif
+#define TRAFFIC_STEP_DURATION (CLOCK_SECOND * 300)
+
+/* Batching: buffer up to NODE_BATCH_SIZE temperature samples and send them
+ * as one delta-encoded frame when the batch is full or NODE_BATCH_DEADLINE
+ * after its first sample; 0 sends every sample on its own */
+#ifdef NODE_CONF_BATCH_SIZE
+#define NODE_BATCH_SIZE NODE_CONF_BATCH_SIZE
+#else
+#define NODE_BATCH_SIZE 0
+#endif
+#ifdef NODE_CONF_BATCH_DEADLINE
+#define NODE_BATCH_DEADLINE NODE_CONF_BATCH_DEADLINE
+#else
+#define NODE_BATCH_DEADLINE (CLOCK_SECOND * 60)
+#endif
+#if NODE_BATCH_SIZE > TELEMETRY_BATCH_MAX
+#error "NODE_CONF_BATCH_SIZE is larger than TELEMETRY_BATCH_MAX"
+#endif
+
+/* Per-hop tracing: every NODE_TRACE_EVERY-th report (or batch) collects a
+ * record from each node on its way; 0 traces none. Nodes append records to
+ * traced reports of others whatever this setting. */
+#ifdef NODE_CONF_TRACE_EVERY
+#define NODE_TRACE_EVERY NODE_CONF_TRACE_EVERY
+#else
+#define NODE_TRACE_EVERY 0
+#endif
+
+/* Change-driven reporting: a sample is reported only when it is
+ * NODE_REPORT_DELTA away from the last reported one, or when nothing was
+ * reported for NODE_REPORT_HEARTBEAT. While the queue to the parent holds
+ * NODE_CONGESTION_QUEUE frames or more, or the parent link ETX reaches
+ * NODE_CONGESTION_ETX, the sampling interval (PINGs included) doubles at
+ * every sample, up to the heartbeat; it halves back once the congestion
+ * clears. 0 reports every sample. */
+#ifdef NODE_CONF_ADAPTIVE_REPORTING
+#define NODE_ADAPTIVE_REPORTING NODE_CONF_ADAPTIVE_REPORTING
+#else
+#define NODE_ADAPTIVE_REPORTING 0
+#endif
+#ifdef NODE_CONF_REPORT_DELTA
+#define NODE_REPORT_DELTA NODE_CONF_REPORT_DELTA
+#else
+#define NODE_REPORT_DELTA 2
+#endif
+#ifdef NODE_CONF_REPORT_HEARTBEAT
+#define NODE_REPORT_HEARTBEAT NODE_CONF_REPORT_HEARTBEAT
+#else
+#define NODE_REPORT_HEARTBEAT (CLOCK_SECOND * 60)
+#endif
+#ifdef NODE_CONF_CONGESTION_QUEUE
+#define NODE_CONGESTION_QUEUE NODE_CONF_CONGESTION_QUEUE
+#else
+#define NODE_CONGESTION_QUEUE 4
+#endif
+#ifdef NODE_CONF_CONGESTION_ETX
+#define NODE_CONGESTION_ETX NODE_CONF_CONGESTION_ETX
+#else
+#define NODE_CONGESTION_ETX (3 * LINK_STATS_ETX_DIVISOR)
+#endif
 // #define RF_CONF_TXPOWER 7
 
 /************************************************
  *                  Structs                     *
  ************************************************/
-/* Structure for sensor payload including PING data */
+/* PING probe awaiting its PONG */
 typedef struct {
-  uint8_t node_id;          // Node ID
-  uint16_t tx_count;        // Transmission count
-  uint16_t rx_count;        // Reception count (PONG received)
-  uint64_t send_time;       // Send time (network uptime ticks)
-  int16_t temperature;      // Temperature in Celsius
-  uip_ipaddr_t parent_addr; // Parent IP address
-  uint16_t ping_sent;       // Total PINGs sent
-  uint16_t pong_received;   // Total PONGs received
-  uint16_t rtt;             // Round-Trip Time in ms
-} sensor_payload_t;
+  uint16_t seq;             // Sequence number of the probe
+  clock_time_t sent;        // When it was sent, for the timeout
+  uint8_t in_use;
+} ping_probe_t;
 
 /************************************************
  *              Global variables                *
  ************************************************/
 static struct simple_udp_connection udp_conn;
 static uint16_t node_tx_count = 0;
+static uint16_t reports_sent = 0;
 static uint16_t ping_sent_count = 0;
 static uint16_t pong_received_count = 0;
-static rtimer_clock_t last_ping_time;
+static uint16_t ping_lost_count = 0;
+static uint16_t ping_seq = 0;
+static ping_probe_t pings_in_flight[NODE_PINGS_IN_FLIGHT];
 static uint16_t last_rtt = 0; // Global variable to store the last valid RTT
+#if NODE_ADAPTIVE_REPORTING
+static int16_t last_reported_temp;
+static clock_time_t last_report_time;
+static uint8_t reported_once = 0;
+static uint8_t sample_backoff = 0;  // Sampling interval doubled this many times
+#endif /* NODE_ADAPTIVE_REPORTING */
+#if ENERGEST_CONF_ON
+/* Energest times at the previous report: CPU, LPM, listen, transmit */
+static uint64_t energest_last[4];
+#endif /* ENERGEST_CONF_ON */
+#if NODE_TRAFFIC_STEPS
+static const clock_time_t traffic_steps[] = {
+  CLOCK_SECOND * 10, CLOCK_SECOND * 2, CLOCK_SECOND / 4,
+  CLOCK_SECOND * 2, CLOCK_SECOND * 10
+};
+static uint8_t traffic_step = 0;
+#endif /* NODE_TRAFFIC_STEPS */
+#if NODE_BATCH_SIZE
+static telemetry_sample_t batch[NODE_BATCH_SIZE];
+static uint8_t batch_len = 0;
+static struct etimer batch_timer;
+#endif /* NODE_BATCH_SIZE */
 
 /************************************************
  *                  Functions                   *
  ************************************************/
-static void send_temperature_data();
+static int16_t read_temperature();
+static void send_temperature_data(int16_t temperature);
+#if NODE_BATCH_SIZE
+static void sample_temperature(int16_t temperature);
+static void send_batch();
+#endif /* NODE_BATCH_SIZE */
+static clock_time_t sample_interval();
+#if NODE_ADAPTIVE_REPORTING
+static int report_due(int16_t temperature);
+static int congested();
+#endif /* NODE_ADAPTIVE_REPORTING */
 static void send_ping();
+static void expire_pings();
+static int trace_report(uint8_t *buf, int len, uint16_t size);
+static void fill_energy(telemetry_sensor_t *payload);
 static void udp_ping_callback(struct simple_udp_connection *c,
                               const uip_ipaddr_t *sender_addr,
                               uint16_t sender_port,
@@ -70,6 +194,9 @@ AUTOSTART_PROCESSES(&sensor_node_process);
 
 PROCESS_THREAD(sensor_node_process, ev, data) {
   static struct etimer et;
+#if NODE_TRAFFIC_STEPS
+  static struct etimer step_timer;
+#endif /* NODE_TRAFFIC_STEPS */
   PROCESS_BEGIN();
 
   LOG_INFO("Starting sensor node %u...\r\n", node_id);
@@ -78,14 +205,60 @@ PROCESS_THREAD(sensor_node_process, ev, data) {
 
   /* Register UDP connection with callback */
   simple_udp_register(&udp_conn, UDP_PORT, NULL, UDP_PORT, udp_ping_callback);
+  hop_trace_init(UDP_PORT);
+  traffic_class_init(UDP_PORT);
 
   /* Set timer for periodic data transmission */
-  etimer_set(&et, CLOCK_SECOND * 10);
+  etimer_set(&et, SEND_INTERVAL);
+#if NODE_TRAFFIC_STEPS
+  etimer_set(&step_timer, TRAFFIC_STEP_DURATION);
+#endif /* NODE_TRAFFIC_STEPS */
   while(1) {
-    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
-    send_temperature_data();
-    send_ping();
-    etimer_reset(&et);
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER ||
+                             ev == serial_line_event_message);
+
+    if(ev == serial_line_event_message) {
+      if(strcmp((const char *)data, CELLS_COMMAND) == 0) {
+        sf_simple_print_cells();
+      }
+      continue;
+    }
+
+#if NODE_TRAFFIC_STEPS
+    if(data == &step_timer) {
+      if(traffic_step < sizeof(traffic_steps) / sizeof(traffic_steps[0]) - 1) {
+        traffic_step++;
+        etimer_reset(&step_timer);
+      }
+      LOG_INFO("Traffic step %u: report every %lu ms\r\n", traffic_step,
+               (unsigned long)(traffic_steps[traffic_step] * 1000 / CLOCK_SECOND));
+      etimer_reset_with_new_interval(&et, traffic_steps[traffic_step]);
+      continue;
+    }
+#endif /* NODE_TRAFFIC_STEPS */
+
+#if NODE_BATCH_SIZE
+    if(data == &batch_timer) {
+      send_batch();
+      continue;
+    }
+#endif /* NODE_BATCH_SIZE */
+
+    if(data == &et) {
+      int16_t temperature = read_temperature();
+#if NODE_ADAPTIVE_REPORTING
+      if(report_due(temperature))
+#endif /* NODE_ADAPTIVE_REPORTING */
+      {
+#if NODE_BATCH_SIZE
+        sample_temperature(temperature);
+#else
+        send_temperature_data(temperature);
+#endif /* NODE_BATCH_SIZE */
+      }
+      send_ping();
+      etimer_reset_with_new_interval(&et, sample_interval());
+    }
   }
 
   PROCESS_END();
@@ -99,82 +272,296 @@ static void udp_ping_callback(struct simple_udp_connection *c,
                               uint16_t receiver_port,
                               const uint8_t *data,
                               uint16_t datalen) {
+  telemetry_probe_t probe;
+
   /* Check if the message is a PONG response */
-  if (datalen >= 4 && memcmp(data, "PONG", 4) == 0) { // Check for PONG message
-    pong_received_count++;
-    rtimer_clock_t current_time = RTIMER_NOW();
+  if (telemetry_probe_decode(TELEMETRY_TYPE_PONG, &probe, data, datalen) < 0) {
+    return;
+  }
 
-    // Update RTT and store in last_rtt
-    last_rtt = (current_time - last_ping_time) * 1000 / RTIMER_SECOND;
+  ping_probe_t *p = NULL;
+  for (int i = 0; i < NODE_PINGS_IN_FLIGHT; i++) {
+    if (pings_in_flight[i].in_use && pings_in_flight[i].seq == probe.seq) {
+      p = &pings_in_flight[i];
+      break;
+    }
+  }
+  if (p == NULL) {
+    /* already counted as lost, or a duplicate */
+    LOG_WARN("Late PONG %u ignored\r\n", probe.seq);
+    return;
+  }
+  p->in_use = 0;
+  pong_received_count++;
 
-    LOG_INFO("PONG received from Coordinator | RTT: %u ms\r\n", last_rtt);
+  // RTT from the timestamp echoed by the coordinator, whatever other probes are in flight
+  uint32_t elapsed = (uint32_t)RTIMER_NOW() - probe.timestamp;
+  last_rtt = (uint64_t)elapsed * 1000 / RTIMER_SECOND;
+
+  LOG_INFO("PONG %u received from Coordinator | RTT: %u ms\r\n", probe.seq, last_rtt);
 }
 
+/* Count the probes left unanswered for too long as lost */
+static void expire_pings() {
+  for (int i = 0; i < NODE_PINGS_IN_FLIGHT; i++) {
+    if (pings_in_flight[i].in_use &&
+        clock_time() - pings_in_flight[i].sent > NODE_PING_TIMEOUT) {
+      pings_in_flight[i].in_use = 0;
+      ping_lost_count++;
+      LOG_WARN("PING %u lost\r\n", pings_in_flight[i].seq);
+    }
+  }
 }
 
 /* Function to send PING message to Coordinator */
 static void send_ping() {
   uip_ipaddr_t dest_ipaddr;
 
+  expire_pings();
+
   if(NETSTACK_ROUTING.get_root_ipaddr(&dest_ipaddr)) {
-    ping_sent_count++;
-    last_ping_time = RTIMER_NOW();
+    /* Take a free slot, or give up on the oldest probe */
+    ping_probe_t *p = &pings_in_flight[0];
+    for (int i = 0; i < NODE_PINGS_IN_FLIGHT; i++) {
+      if (!pings_in_flight[i].in_use) {
+        p = &pings_in_flight[i];
+        break;
+      }
+      if (clock_time() - pings_in_flight[i].sent > clock_time() - p->sent) {
+        p = &pings_in_flight[i];
+      }
+    }
+    if (p->in_use) {
+      ping_lost_count++;
+      LOG_WARN("PING %u lost\r\n", p->seq);
+    }
 
-    char ping_msg[] = "PING";
-    simple_udp_sendto(&udp_conn, ping_msg, sizeof(ping_msg), &dest_ipaddr);
+    telemetry_probe_t probe;
+    uint8_t buf[TELEMETRY_PROBE_LEN];
+    probe.seq = ++ping_seq;
+    probe.timestamp = RTIMER_NOW();
+    int len = telemetry_probe_encode(TELEMETRY_TYPE_PING, &probe, buf, sizeof(buf));
 
-    /* Calculate Packet Loss */
-    int packet_loss = (ping_sent_count > 0) ? 
-                      (int)((1 - (float)pong_received_count / ping_sent_count) * 100) : 100;
+    p->seq = probe.seq;
+    p->sent = clock_time();
+    p->in_use = 1;
+    ping_sent_count++;
+    simple_udp_sendto(&udp_conn, buf, len, &dest_ipaddr);
 
-    LOG_INFO("PING sent to Coordinator | PING count: %u | PONG received: %u | Packet Loss: %d%%\r\n",
-             ping_sent_count, pong_received_count, packet_loss);
+    /* Calculate Packet Loss over the probes already answered or lost */
+    int packet_loss = (ping_lost_count + pong_received_count > 0) ?
+                      (int)((uint32_t)ping_lost_count * 100 / (ping_lost_count + pong_received_count)) : 0;
+
+    LOG_INFO("PING %u sent to Coordinator | PING count: %u | PONG received: %u | Lost: %u | Packet Loss: %d%%\r\n",
+             probe.seq, ping_sent_count, pong_received_count, ping_lost_count, packet_loss);
   } else {
     LOG_ERR("Failed to get coordinator IP address for PING.\r\n");
   }
 }
 
-/* Function to send temperature data along with PING metrics */
-static void send_temperature_data() {
-  uip_ipaddr_t dest_ipaddr;
-  int8_t real_temp = 20 + (rand() % 100) / 10; // Random temperature value between 20 and 29.9
-
-  node_tx_count++;
-  uint64_t send_time = tsch_get_network_uptime_ticks();
+/* Have every NODE_TRACE_EVERY-th report collect a per-hop trace */
+static int trace_report(uint8_t *buf, int len, uint16_t size) {
+  reports_sent++;
+#if NODE_TRACE_EVERY
+  if (len > 0 && reports_sent % NODE_TRACE_EVERY == 0) {
+    int traced = telemetry_trace_start(buf, len, size);
+    if (traced > 0) {
+      return traced;
+    }
+  }
+#endif /* NODE_TRACE_EVERY */
+  return len;
+}
 
-  sensor_payload_t payload;
-  payload.node_id = node_id;
-  payload.tx_count = node_tx_count;
-  payload.rx_count = pong_received_count;
-  payload.send_time = send_time;
-  payload.temperature = real_temp;
+/* Fill in the counters and the parent of a report */
+static void fill_report(telemetry_sensor_t *payload) {
+  payload->node_id = node_id;
+  payload->tx_count = node_tx_count;
+  payload->rx_count = pong_received_count;
 
-  /* Copy parent address */
+  /* Short ID of the parent */
+  payload->parent_id = 0;
   rpl_dag_t *dag = rpl_get_any_dag();
   if (dag != NULL && dag->preferred_parent != NULL) {
     uip_ipaddr_t *parent_addr = rpl_neighbor_get_ipaddr(dag->preferred_parent);
     if (parent_addr != NULL) {
-      uip_ipaddr_copy(&payload.parent_addr, parent_addr);
-    } else {
-      uip_create_unspecified(&payload.parent_addr);
+      payload->parent_id = telemetry_short_id(parent_addr);
     }
-  } else {
-    uip_create_unspecified(&payload.parent_addr);
   }
 
   /* Include PING data */
-  payload.ping_sent = ping_sent_count;
-  payload.pong_received = pong_received_count;
+  payload->ping_sent = ping_sent_count;
+  payload->pong_received = pong_received_count;
 
   // Use last valid RTT calculated in udp_ping_callback()
-  payload.rtt = last_rtt;
+  payload->rtt = last_rtt;
+
+  fill_energy(payload);
+}
+
+/* Duty cycles since the previous report, from Energest. Deep LPM counts as
+ * LPM; the CPU and LPM times add up to the elapsed time. */
+static void fill_energy(telemetry_sensor_t *payload) {
+#if ENERGEST_CONF_ON
+  uint64_t now[4];
+  uint64_t delta[4];
+  uint64_t elapsed;
+
+  energest_flush();
+  now[0] = energest_type_time(ENERGEST_TYPE_CPU);
+  now[1] = energest_type_time(ENERGEST_TYPE_LPM) +
+           energest_type_time(ENERGEST_TYPE_DEEP_LPM);
+  now[2] = energest_type_time(ENERGEST_TYPE_LISTEN);
+  now[3] = energest_type_time(ENERGEST_TYPE_TRANSMIT);
+  for(int i = 0; i < 4; i++) {
+    delta[i] = now[i] - energest_last[i];
+    energest_last[i] = now[i];
+  }
+
+  elapsed = delta[0] + delta[1];
+  if(elapsed > 0) {
+    payload->cpu = delta[0] * TELEMETRY_DUTY_CYCLE_SCALE / elapsed;
+    payload->lpm = delta[1] * TELEMETRY_DUTY_CYCLE_SCALE / elapsed;
+    payload->listen = delta[2] * TELEMETRY_DUTY_CYCLE_SCALE / elapsed;
+    payload->transmit = delta[3] * TELEMETRY_DUTY_CYCLE_SCALE / elapsed;
+    return;
+  }
+#endif /* ENERGEST_CONF_ON */
+  payload->cpu = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+  payload->lpm = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+  payload->listen = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+  payload->transmit = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+}
+
+/* Random temperature value between 20 and 29 */
+static int16_t read_temperature() {
+  return 20 + (rand() % 100) / 10;
+}
+
+/* Time to the next sample: the report interval of the traffic profile,
+ * stretched while the network is congested */
+static clock_time_t sample_interval() {
+#if NODE_TRAFFIC_STEPS
+  clock_time_t interval = traffic_steps[traffic_step];
+#else
+  clock_time_t interval = SEND_INTERVAL;
+#endif /* NODE_TRAFFIC_STEPS */
+#if NODE_ADAPTIVE_REPORTING
+  if(congested()) {
+    if((interval << sample_backoff) < NODE_REPORT_HEARTBEAT) {
+      sample_backoff++;
+    }
+  } else if(sample_backoff > 0) {
+    sample_backoff--;
+  }
+  interval <<= sample_backoff;
+  if(interval > NODE_REPORT_HEARTBEAT) {
+    interval = NODE_REPORT_HEARTBEAT;
+  }
+#endif /* NODE_ADAPTIVE_REPORTING */
+  return interval;
+}
+
+#if NODE_ADAPTIVE_REPORTING
+/* Whether the queue to the parent or the parent link says the mesh is
+ * struggling */
+static int congested() {
+  struct tsch_neighbor *time_source = tsch_queue_get_time_source();
+  if(time_source != NULL &&
+     tsch_queue_nbr_packet_count(time_source) >= NODE_CONGESTION_QUEUE) {
+    return 1;
+  }
+  rpl_dag_t *dag = rpl_get_any_dag();
+  return dag != NULL && dag->preferred_parent != NULL &&
+         rpl_neighbor_get_link_metric(dag->preferred_parent) >= NODE_CONGESTION_ETX;
+}
+
+/* Whether a sample is worth a report; if so, it becomes the reference for
+ * the next ones */
+static int report_due(int16_t temperature) {
+  int16_t delta = temperature - last_reported_temp;
+  if(reported_once && delta < NODE_REPORT_DELTA && delta > -NODE_REPORT_DELTA &&
+     clock_time() - last_report_time < NODE_REPORT_HEARTBEAT) {
+    LOG_DBG("Sample %dC not reported\r\n", temperature);
+    return 0;
+  }
+  reported_once = 1;
+  last_reported_temp = temperature;
+  last_report_time = clock_time();
+  return 1;
+}
+#endif /* NODE_ADAPTIVE_REPORTING */
+
+/* Function to send temperature data along with PING metrics */
+static void send_temperature_data(int16_t real_temp) {
+  uip_ipaddr_t dest_ipaddr;
+
+  node_tx_count++;
+
+  telemetry_sensor_t payload;
+  fill_report(&payload);
+  payload.asn = tsch_current_asn.ls4b;
+  payload.temperature = real_temp;
+
+  uint8_t buf[TELEMETRY_SENSOR_LEN + 1];
+  int len = telemetry_sensor_encode(&payload, buf, sizeof(buf));
+  len = trace_report(buf, len, sizeof(buf));
 
   if (NETSTACK_ROUTING.get_root_ipaddr(&dest_ipaddr)) {
-    simple_udp_sendto(&udp_conn, &payload, sizeof(payload), &dest_ipaddr);
-    LOG_INFO("Node %u: Sent data | TX: %u | Temp: %dC | PING Sent: %u | PONG Received: %u | RTT: %u ms\r\n",
-             node_id, node_tx_count, real_temp, payload.ping_sent, payload.pong_received, payload.rtt);
+    simple_udp_sendto(&udp_conn, buf, len, &dest_ipaddr);
+    LOG_INFO("Node %u: Sent data | TX: %u | Temp: %dC | PING Sent: %u | PONG Received: %u | RTT: %u ms | Listen: %u.%02u%% | Transmit: %u.%02u%%\r\n",
+             node_id, node_tx_count, real_temp, payload.ping_sent, payload.pong_received, payload.rtt,
+             payload.listen / 100, payload.listen % 100,
+             payload.transmit / 100, payload.transmit % 100);
   } else {
     LOG_ERR("Failed to get coordinator IP address.\r\n");
   }
 }
 
+#if NODE_BATCH_SIZE
+/* Function to buffer one temperature sample, sending the batch when full */
+static void sample_temperature(int16_t temperature) {
+  telemetry_sample_t sample;
+  sample.asn = tsch_current_asn.ls4b;
+  sample.temperature = temperature;
+
+  /* A sample too far from the previous one starts a new batch */
+  if (batch_len > 0 && !telemetry_batch_fits(&batch[batch_len - 1], &sample)) {
+    send_batch();
+  }
+
+  node_tx_count++;
+  batch[batch_len++] = sample;
+  if (batch_len == 1) {
+    etimer_set(&batch_timer, NODE_BATCH_DEADLINE);
+  }
+  if (batch_len == NODE_BATCH_SIZE) {
+    send_batch();
+  }
+}
+
+/* Function to send the buffered samples as one frame */
+static void send_batch() {
+  uip_ipaddr_t dest_ipaddr;
+  telemetry_sensor_t last;
+  uint8_t buf[TELEMETRY_BATCH_LEN(NODE_BATCH_SIZE) + 1];
+
+  etimer_stop(&batch_timer);
+  if (batch_len == 0) {
+    return;
+  }
+
+  fill_report(&last);
+  int len = telemetry_batch_encode(&last, batch, batch_len, buf, sizeof(buf));
+  len = trace_report(buf, len, sizeof(buf));
+
+  if (len > 0 && NETSTACK_ROUTING.get_root_ipaddr(&dest_ipaddr)) {
+    simple_udp_sendto(&udp_conn, buf, len, &dest_ipaddr);
+    LOG_INFO("Node %u: Sent batch | Samples: %u | TX: %u | %d bytes\r\n",
+             node_id, batch_len, node_tx_count, len);
+  } else {
+    LOG_ERR("Failed to send batch of %u samples.\r\n", batch_len);
+  }
+  batch_len = 0;
+}
+#endif /* NODE_BATCH_SIZE */
@@ -20,6 +20,9 @@
 #define RPL_CONF_OF rpl_mrhof
 #define RPL_CONF_INIT_LINK_METRIC RPL_INIT_LINK_METRIC_ETX
 
+/* Energest feeds the duty cycles of the sensor reports */
+#define ENERGEST_CONF_ON 1
+
 
 
 /* Needed for cc2420 platforms only */
@@ -31,6 +34,18 @@
 /* Enable Sixtop Implementation */
 #define TSCH_CONF_WITH_SIXTOP 1
 
+/* sf-simple pins unicast frames to its negotiated cells to keep per-cell
+ * delivery statistics */
+#define TSCH_CONF_WITH_LINK_SELECTOR 1
+
+/* Only bulk telemetry is pinned; probes and control take the first cell,
+ * overtaking the pinned frames queued to the same neighbour */
+#define TSCH_CALLBACK_PACKET_READY traffic_class_callback_packet_ready
+#define SF_SIMPLE_CALLBACK_PIN_PACKET traffic_class_callback_pin_packet
+
+/* sf-simple moves its autonomous TX cell along with the RPL parent */
+#define TSCH_CALLBACK_NEW_TIME_SOURCE sf_simple_callback_new_time_source
+
 /*******************************************************/
 /******************* Configure TSCH ********************/
 /*******************************************************/
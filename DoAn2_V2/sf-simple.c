@@ -46,28 +46,175 @@
 #include "net/mac/tsch/sixtop/sixp-nbr.h"
 #include "net/mac/tsch/sixtop/sixp-pkt.h"
 #include "net/mac/tsch/sixtop/sixp-trans.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
 
 #include "sf-simple.h"
 
+#include <stdio.h>
+
+#if SF_SIMPLE_CELL_STATS && !TSCH_WITH_LINK_SELECTOR
+#error "SF_SIMPLE_CELL_STATS needs TSCH_CONF_WITH_LINK_SELECTOR"
+#endif
+
 #define DEBUG DEBUG_PRINT
 #include "net/net-debug.h"
 
+#ifdef SF_SIMPLE_CALLBACK_PIN_PACKET
+int SF_SIMPLE_CALLBACK_PIN_PACKET(void);
+#endif
+
+/* Delay before a follow-up request (next LIST page, ...), once the 6P
+ * transaction that triggered it is over */
+#define REQUEST_DEFER_DELAY (CLOCK_SECOND / 8)
+
 typedef struct {
   uint16_t timeslot_offset;
   uint16_t channel_offset;
 } sf_simple_cell_t;
 
-static const uint16_t slotframe_handle = 0;
-static uint8_t res_storage[4 + SF_SIMPLE_MAX_LINKS * 4];
-static uint8_t req_storage[4 + SF_SIMPLE_MAX_LINKS * 4];
+/* Timeslot occupancy of one slotframe, one bit per timeslot */
+#define OCCUPANCY_WORDS ((SF_SIMPLE_MAX_TIMESLOTS + 31) / 32)
+typedef struct {
+  const struct tsch_slotframe *slotframe;
+  uint16_t num_free;
+  uint32_t used[OCCUPANCY_WORDS];
+} sf_simple_occupancy_t;
+
+/* Body of a 6P message owned by an ongoing transaction. 6P runs at most one
+ * transaction per neighbour, so the peer address identifies it; the buffer
+ * lives until the transaction completes or times out. */
+typedef struct sf_simple_trans_buf {
+  struct sf_simple_trans_buf *next;
+  linkaddr_t peer_addr;
+  uint16_t slotframe_handle;  /* slotframe the transaction is about */
+  uint8_t link_options;       /* our side of the cells it is about */
+  uint16_t body_len;
+  uint8_t body[4 + SF_SIMPLE_MAX_LINKS * 4];
+  uint16_t aux_len;
+  uint8_t aux[SF_SIMPLE_MAX_LINKS * 4];  /* cells a RELOCATE moves away from */
+} sf_simple_trans_buf_t;
+
+/* 6P request we initiated, kept until it succeeds so that a lost or
+ * rejected request is retried after a jittered exponential back-off. A
+ * schedule check goes on from COUNT to LIST pages in the same entry. */
+typedef struct {
+  linkaddr_t peer_addr;
+  struct ctimer retry_timer;
+  sixp_pkt_cmd_t cmd;
+  uint8_t in_use;
+  uint8_t pending;      /* request sent, waiting for the response */
+  uint8_t num_links;
+  uint8_t attempts;
+  uint16_t offset;      /* next LIST page */
+} sf_simple_request_t;
 
+typedef struct {
+  linkaddr_t addr;
+  uint8_t in_use;
+  uint8_t samples;
+  uint16_t queue_sum;   /* sum of queue occupancy samples in the window */
+  uint16_t tx_frames;   /* unicast frames handed to the MAC in the window */
+  uint8_t idle_windows; /* windows in a row its cells sat idle */
+} sf_simple_peer_t;
+
+/* Statistics of one of our dedicated TX cells. TSCH reports one final
+ * status per frame to the upper layers, so a frame is accounted to the cell
+ * it was pinned to whatever the number of attempts it took. tx and tx_ack
+ * follow the recent delivery ratio, for relocation; the usage counters
+ * run from the installation of the cell, for sf_simple_print_cells(). */
+typedef struct {
+  linkaddr_t peer_addr;
+  uint16_t slotframe_handle;
+  uint16_t timeslot_offset;
+  uint8_t in_use;
+  uint8_t relocating;   /* RELOCATE under way, no more frames pinned to it */
+  uint8_t outstanding;  /* frames pinned to the cell and not reported yet */
+  uint16_t tx;          /* frames sent over the cell */
+  uint16_t tx_ack;      /* ... and acknowledged */
+  uint32_t since_asn;   /* ASN the cell was installed at */
+  uint16_t sent;        /* usage counters, saturating: frames sent, */
+  uint16_t acked;       /* acknowledged, */
+  uint16_t failed;      /* and not acknowledged or collided */
+} sf_simple_cell_stats_t;
+
+/* Unicast frames received from a neighbour. TSCH does not tell the upper
+ * layers which cell a frame came in over, so they are counted against the
+ * data slotframe of our RX cells from the neighbour, together with those
+ * that came over the shared cells. */
+typedef struct {
+  linkaddr_t peer_addr;
+  uint16_t slotframe_handle;
+  uint8_t in_use;
+  uint32_t since_asn;   /* ASN of the first frame */
+  uint16_t received;    /* saturating */
+} sf_simple_rx_stats_t;
+
+MEMB(trans_buf_memb, sf_simple_trans_buf_t, SF_SIMPLE_MAX_TRANSACTIONS);
+LIST(trans_buf_list);
+static sf_simple_request_t requests[SF_SIMPLE_MAX_TRANSACTIONS];
+static sf_simple_occupancy_t occupancy[SF_SIMPLE_MAX_SLOTFRAMES];
+
+#if SF_SIMPLE_ADAPTIVE
+static sf_simple_peer_t peers[SF_SIMPLE_MAX_PEERS];
+#endif /* SF_SIMPLE_ADAPTIVE */
+#if SF_SIMPLE_CELL_STATS
+static sf_simple_cell_stats_t cell_stats[SF_SIMPLE_MAX_CELL_STATS];
+static sf_simple_rx_stats_t rx_stats[SF_SIMPLE_MAX_PEERS];
+#endif /* SF_SIMPLE_CELL_STATS */
+static struct ctimer housekeeping_timer;
+/* TX cells the peer under schedule check listed, one check at a time */
+static uint32_t sync_confirmed[OCCUPANCY_WORDS];
+static uint8_t sync_mismatch;
+static linkaddr_t last_time_source;
+static clock_time_t since_sync;
+#if SF_SIMPLE_AUTONOMOUS
+/* neighbour our autonomous TX cell goes to, null when there is none */
+static linkaddr_t autonomous_tx_addr;
+#endif /* SF_SIMPLE_AUTONOMOUS */
+
+static sf_simple_trans_buf_t *trans_buf_alloc(const linkaddr_t *peer_addr);
+static sf_simple_trans_buf_t *trans_buf_find(const linkaddr_t *peer_addr);
+static sf_simple_trans_buf_t *trans_buf_find_by_body(const void *body);
+static void trans_buf_free(sf_simple_trans_buf_t *buf);
+static void trans_buf_free_by_body(const void *body);
 static void read_cell(const uint8_t *buf, sf_simple_cell_t *cell);
+static struct tsch_slotframe *get_slotframe(uint16_t handle);
+static uint16_t data_slotframe_handle(const linkaddr_t *peer_addr);
+#if SF_SIMPLE_AUTONOMOUS
+static uint16_t autonomous_timeslot(const linkaddr_t *addr);
+static void autonomous_update(void);
+#endif /* SF_SIMPLE_AUTONOMOUS */
+static struct tsch_slotframe *get_request_slotframe(sixp_pkt_cmd_t cmd,
+                                                    const uint8_t *body,
+                                                    uint16_t body_len);
+static int set_request_slotframe(sixp_pkt_cmd_t cmd, uint16_t handle,
+                                 uint8_t *body, uint16_t body_len);
 static void print_cell_list(const uint8_t *cell_list, uint16_t cell_list_len);
-static void add_links_to_schedule(const linkaddr_t *peer_addr,
-                                  uint8_t link_option,
-                                  const uint8_t *cell_list,
-                                  uint16_t cell_list_len);
-static void remove_links_to_schedule(const uint8_t *cell_list,
+static sf_simple_occupancy_t *get_occupancy(struct tsch_slotframe *slotframe);
+static void occupancy_set(struct tsch_slotframe *slotframe, uint16_t timeslot);
+static void occupancy_clear(struct tsch_slotframe *slotframe,
+                            uint16_t timeslot);
+static int timeslot_in_use(struct tsch_slotframe *slotframe, uint16_t timeslot);
+static int pick_free_timeslot(const uint32_t *used, uint16_t num_free,
+                              uint16_t length);
+static uint8_t draw_candidate_cells(struct tsch_slotframe *slotframe,
+                                    sf_simple_cell_t *cell_list,
+                                    uint8_t max_cells);
+static int cell_list_has_timeslot(const uint8_t *cell_list,
+                                  uint16_t cell_list_len, uint16_t timeslot);
+static int cell_list_has_cell(const uint8_t *cell_list,
+                              uint16_t cell_list_len,
+                              const sf_simple_cell_t *cell);
+static uint16_t add_links_to_schedule(struct tsch_slotframe *slotframe,
+                                      const linkaddr_t *peer_addr,
+                                      uint8_t link_option,
+                                      const uint8_t *cell_list,
+                                      uint16_t cell_list_len);
+static void remove_links_to_schedule(struct tsch_slotframe *slotframe,
+                                     const linkaddr_t *peer_addr,
+                                     uint8_t link_options,
+                                     const uint8_t *cell_list,
                                      uint16_t cell_list_len);
 static void add_response_sent_callback(void *arg, uint16_t arg_len,
                                        const linkaddr_t *dest_addr,
@@ -75,10 +222,26 @@ static void add_response_sent_callback(void *arg, uint16_t arg_len,
 static void delete_response_sent_callback(void *arg, uint16_t arg_len,
                                           const linkaddr_t *dest_addr,
                                           sixp_output_status_t status);
+static void relocate_response_sent_callback(void *arg, uint16_t arg_len,
+                                            const linkaddr_t *dest_addr,
+                                            sixp_output_status_t status);
+static void send_busy_response(const linkaddr_t *peer_addr);
 static void add_req_input(const uint8_t *body, uint16_t body_len,
                           const linkaddr_t *peer_addr);
 static void delete_req_input(const uint8_t *body, uint16_t body_len,
                              const linkaddr_t *peer_addr);
+static void relocate_req_input(const uint8_t *body, uint16_t body_len,
+                               const linkaddr_t *peer_addr);
+static uint8_t cell_options_to_link_options(sixp_pkt_cell_options_t options);
+static uint16_t count_links_with(struct tsch_slotframe *slotframe,
+                                 const linkaddr_t *peer_addr,
+                                 uint8_t link_options);
+static void count_req_input(const uint8_t *body, uint16_t body_len,
+                            const linkaddr_t *peer_addr);
+static void list_req_input(const uint8_t *body, uint16_t body_len,
+                           const linkaddr_t *peer_addr);
+static void clear_req_input(const uint8_t *body, uint16_t body_len,
+                            const linkaddr_t *peer_addr);
 static void input(sixp_pkt_type_t type, sixp_pkt_code_t code,
                   const uint8_t *body, uint16_t body_len,
                   const linkaddr_t *src_addr);
@@ -88,12 +251,205 @@ static void request_input(sixp_pkt_cmd_t cmd,
 static void response_input(sixp_pkt_rc_t rc,
                            const uint8_t *body, uint16_t body_len,
                            const linkaddr_t *peer_addr);
+static void count_res_input(sf_simple_request_t *req,
+                            const uint8_t *body, uint16_t body_len,
+                            const linkaddr_t *peer_addr);
+static void list_res_input(sf_simple_request_t *req, sixp_pkt_rc_t rc,
+                           const uint8_t *body, uint16_t body_len,
+                           const linkaddr_t *peer_addr);
+static int send_list_request(const linkaddr_t *peer_addr, uint16_t offset);
+static sf_simple_request_t *request_find(const linkaddr_t *peer_addr);
+static sf_simple_request_t *request_alloc(const linkaddr_t *peer_addr);
+static void request_defer(const linkaddr_t *peer_addr, sixp_pkt_cmd_t cmd);
+static void request_started(const linkaddr_t *peer_addr, sixp_pkt_cmd_t cmd,
+                            uint8_t num_links);
+static void request_done(const linkaddr_t *peer_addr);
+static void request_retry(sf_simple_request_t *req);
+static void request_retry_expired(void *ptr);
+static void remove_all_links_with(const linkaddr_t *peer_addr);
+static void timeout(sixp_pkt_cmd_t cmd, const linkaddr_t *peer_addr);
+static void error(sixp_error_t err, sixp_pkt_cmd_t cmd, uint8_t seqno,
+                  const linkaddr_t *peer_addr);
+static void init(void);
+static uint8_t cell_outstanding(uint16_t handle, uint16_t timeslot);
+#if SF_SIMPLE_CELL_STATS
+static sf_simple_cell_stats_t *cell_stats_find(uint16_t handle,
+                                               uint16_t timeslot);
+static void cell_stats_add(const linkaddr_t *peer_addr, uint16_t handle,
+                           uint16_t timeslot);
+static void cell_stats_remove(uint16_t handle, uint16_t timeslot);
+static void cell_stats_relocation_done(const linkaddr_t *peer_addr);
+static uint32_t cell_occurrences(const sf_simple_cell_stats_t *stats);
+static int relocate_cell(sf_simple_cell_stats_t *stats);
+static void relocate_check(void);
+#endif /* SF_SIMPLE_CELL_STATS */
+static uint8_t count_tx_cells(const linkaddr_t *peer_addr);
+#if SF_SIMPLE_ADAPTIVE
+static sf_simple_peer_t *find_peer(const linkaddr_t *peer_addr, int alloc);
+static void evaluate_peer(sf_simple_peer_t *peer, int is_time_source);
+#endif /* SF_SIMPLE_ADAPTIVE */
+static void housekeeping(void *ptr);
+static void forget_peers(void);
+#if SF_SIMPLE_ADAPTIVE || SF_SIMPLE_CELL_STATS
+static void sniffer_output(int mac_status);
+#endif
+#if SF_SIMPLE_CELL_STATS
+static void sniffer_input(void);
+#endif /* SF_SIMPLE_CELL_STATS */
 
 /*
  * scheduling policy:
- * add: if and only if all the requested cells are available, accept the request
- * delete: if and only if all the requested cells are in use, accept the request
+ * add: accept up to NumCells of the candidate cells that are available; the
+ *      response carries the accepted bundle, which may be shorter or empty
+ * delete: accept the requested cells which are in use
+ * relocate: move the cells to relocate, all of which must be shared with
+ *      the requester, to available candidate cells in order; the response
+ *      carries the new cells, the first ones of the relocation list move
+ * count/list: the cells shared with the requester whose options mirror the
+ *      requested ones (its TX cells are our RX cells), listed by pages
+ * clear: drop every cell shared with the requester
+ */
+
+static sf_simple_trans_buf_t *
+trans_buf_alloc(const linkaddr_t *peer_addr)
+{
+  sf_simple_trans_buf_t *buf;
+
+  /* a leftover of an earlier transaction with this peer is recycled */
+  if((buf = trans_buf_find(peer_addr)) == NULL) {
+    if((buf = memb_alloc(&trans_buf_memb)) == NULL) {
+      return NULL;
+    }
+    list_add(trans_buf_list, buf);
+  }
+
+  linkaddr_copy(&buf->peer_addr, peer_addr);
+  buf->body_len = 0;
+  memset(buf->body, 0, sizeof(buf->body));
+  buf->aux_len = 0;
+  buf->slotframe_handle = 0;
+  return buf;
+}
+
+static sf_simple_trans_buf_t *
+trans_buf_find(const linkaddr_t *peer_addr)
+{
+  sf_simple_trans_buf_t *buf;
+
+  for(buf = list_head(trans_buf_list); buf != NULL; buf = list_item_next(buf)) {
+    if(linkaddr_cmp(&buf->peer_addr, peer_addr)) {
+      return buf;
+    }
+  }
+  return NULL;
+}
+
+static void
+trans_buf_free(sf_simple_trans_buf_t *buf)
+{
+  if(buf != NULL) {
+    list_remove(trans_buf_list, buf);
+    memb_free(&trans_buf_memb, buf);
+  }
+}
+
+static sf_simple_trans_buf_t *
+trans_buf_find_by_body(const void *body)
+{
+  sf_simple_trans_buf_t *buf;
+
+  for(buf = list_head(trans_buf_list); buf != NULL; buf = list_item_next(buf)) {
+    if(buf->body == body) {
+      return buf;
+    }
+  }
+  return NULL;
+}
+
+static void
+trans_buf_free_by_body(const void *body)
+{
+  trans_buf_free(trans_buf_find_by_body(body));
+}
+
+/*
+ * The control slotframe is the 6TiSCH minimal one TSCH sets up on
+ * association. Negotiated cells live in an uplink slotframe, towards the
+ * time source, or a downlink one, towards any other neighbour; they are
+ * (re)created on demand since TSCH rebuilds the schedule when it
+ * associates. A 6P request names its slotframe in the Metadata field.
  */
+static struct tsch_slotframe *
+get_slotframe(uint16_t handle)
+{
+  struct tsch_slotframe *slotframe;
+  uint16_t length;
+  int i;
+
+  if((slotframe = tsch_schedule_get_slotframe_by_handle(handle)) != NULL) {
+    return slotframe;
+  }
+
+  if(handle == SF_SIMPLE_UPLINK_SF_HANDLE) {
+    length = SF_SIMPLE_UPLINK_SF_LENGTH;
+  } else if(handle == SF_SIMPLE_DOWNLINK_SF_HANDLE) {
+    length = SF_SIMPLE_DOWNLINK_SF_LENGTH;
+#if SF_SIMPLE_AUTONOMOUS
+  } else if(handle == SF_SIMPLE_AUTONOMOUS_SF_HANDLE) {
+    length = SF_SIMPLE_AUTONOMOUS_SF_LENGTH;
+#endif /* SF_SIMPLE_AUTONOMOUS */
+  } else {
+    return NULL;
+  }
+
+  if((slotframe = tsch_schedule_add_slotframe(handle, length)) != NULL) {
+    /* a bitmap may still point at a former slotframe at that address */
+    for(i = 0; i < SF_SIMPLE_MAX_SLOTFRAMES; i++) {
+      if(occupancy[i].slotframe == slotframe) {
+        occupancy[i].slotframe = NULL;
+      }
+    }
+    PRINTF("sf-simple: Slotframe %u of length %u added\r\r\n",
+           handle, length);
+  }
+  return slotframe;
+}
+
+static uint16_t
+data_slotframe_handle(const linkaddr_t *peer_addr)
+{
+  struct tsch_neighbor *time_source = tsch_queue_get_time_source();
+
+  if(time_source != NULL && linkaddr_cmp(&time_source->addr, peer_addr)) {
+    return SF_SIMPLE_UPLINK_SF_HANDLE;
+  }
+  return SF_SIMPLE_DOWNLINK_SF_HANDLE;
+}
+
+static struct tsch_slotframe *
+get_request_slotframe(sixp_pkt_cmd_t cmd,
+                      const uint8_t *body, uint16_t body_len)
+{
+  sixp_pkt_metadata_t metadata;
+
+  if(sixp_pkt_get_metadata(SIXP_PKT_TYPE_REQUEST,
+                           (sixp_pkt_code_t)(uint8_t)cmd,
+                           &metadata, body, body_len) != 0 ||
+     (metadata != SF_SIMPLE_UPLINK_SF_HANDLE &&
+      metadata != SF_SIMPLE_DOWNLINK_SF_HANDLE)) {
+    return NULL;
+  }
+  return get_slotframe(metadata);
+}
+
+static int
+set_request_slotframe(sixp_pkt_cmd_t cmd, uint16_t handle,
+                      uint8_t *body, uint16_t body_len)
+{
+  return sixp_pkt_set_metadata(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)cmd,
+                               handle, body, body_len);
+}
 
 static void
 read_cell(const uint8_t *buf, sf_simple_cell_t *cell)
@@ -110,26 +466,214 @@ print_cell_list(const uint8_t *cell_list, uint16_t cell_list_len)
 
   for(i = 0; i < cell_list_len; i += sizeof(cell)) {
     read_cell(&cell_list[i], &cell);
-    PRINTF("%u ", cell.timeslot_offset);
+    PRINTF("(%u,%u) ", cell.timeslot_offset, cell.channel_offset);
+  }
+}
+
+static int
+cell_list_has_timeslot(const uint8_t *cell_list, uint16_t cell_list_len,
+                       uint16_t timeslot)
+{
+  uint16_t i;
+  sf_simple_cell_t cell;
+
+  for(i = 0; i < cell_list_len; i += sizeof(cell)) {
+    read_cell(&cell_list[i], &cell);
+    if(cell.timeslot_offset == timeslot) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int
+cell_list_has_cell(const uint8_t *cell_list, uint16_t cell_list_len,
+                   const sf_simple_cell_t *cell)
+{
+  uint16_t i;
+  sf_simple_cell_t c;
+
+  for(i = 0; i + sizeof(c) <= cell_list_len; i += sizeof(c)) {
+    read_cell(&cell_list[i], &c);
+    if(c.timeslot_offset == cell->timeslot_offset &&
+       c.channel_offset == cell->channel_offset) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * A node can use only one cell per timeslot whatever its channel offset,
+ * so a timeslot is taken as soon as any link occupies it. The occupancy of
+ * each slotframe is mirrored in a bitmap, built from the link list the first
+ * time the slotframe is seen and then updated on every add and remove done
+ * by sf-simple.
+ */
+static sf_simple_occupancy_t *
+get_occupancy(struct tsch_slotframe *slotframe)
+{
+  sf_simple_occupancy_t *occ = NULL;
+  struct tsch_link *l;
+  uint16_t length;
+  int i;
+
+  for(i = 0; i < SF_SIMPLE_MAX_SLOTFRAMES; i++) {
+    if(occupancy[i].slotframe == slotframe) {
+      return &occupancy[i];
+    } else if(occ == NULL && occupancy[i].slotframe == NULL) {
+      occ = &occupancy[i];
+    }
+  }
+
+  if(occ == NULL) {
+    /* no room left; recycle the first entry */
+    occ = &occupancy[0];
+  }
+
+  length = MIN(slotframe->size.val, SF_SIMPLE_MAX_TIMESLOTS);
+  memset(occ, 0, sizeof(*occ));
+  occ->slotframe = slotframe;
+  occ->num_free = length;
+  for(l = list_head(slotframe->links_list); l != NULL; l = list_item_next(l)) {
+    if(l->timeslot < length &&
+       !(occ->used[l->timeslot / 32] & (1UL << (l->timeslot % 32)))) {
+      occ->used[l->timeslot / 32] |= 1UL << (l->timeslot % 32);
+      occ->num_free--;
+    }
+  }
+  return occ;
+}
+
+static void
+occupancy_set(struct tsch_slotframe *slotframe, uint16_t timeslot)
+{
+  sf_simple_occupancy_t *occ = get_occupancy(slotframe);
+
+  if(timeslot < SF_SIMPLE_MAX_TIMESLOTS &&
+     !(occ->used[timeslot / 32] & (1UL << (timeslot % 32)))) {
+    occ->used[timeslot / 32] |= 1UL << (timeslot % 32);
+    occ->num_free--;
   }
 }
 
 static void
-add_links_to_schedule(const linkaddr_t *peer_addr, uint8_t link_option,
+occupancy_clear(struct tsch_slotframe *slotframe, uint16_t timeslot)
+{
+  sf_simple_occupancy_t *occ = get_occupancy(slotframe);
+  struct tsch_link *l;
+
+  if(timeslot >= SF_SIMPLE_MAX_TIMESLOTS ||
+     !(occ->used[timeslot / 32] & (1UL << (timeslot % 32)))) {
+    return;
+  }
+
+  /* the timeslot stays in use while a link remains at another offset */
+  for(l = list_head(slotframe->links_list); l != NULL; l = list_item_next(l)) {
+    if(l->timeslot == timeslot) {
+      return;
+    }
+  }
+  occ->used[timeslot / 32] &= ~(1UL << (timeslot % 32));
+  occ->num_free++;
+}
+
+static int
+timeslot_in_use(struct tsch_slotframe *slotframe, uint16_t timeslot)
+{
+  sf_simple_occupancy_t *occ = get_occupancy(slotframe);
+
+  if(timeslot >= SF_SIMPLE_MAX_TIMESLOTS) {
+    return 1;
+  }
+  return (occ->used[timeslot / 32] & (1UL << (timeslot % 32))) != 0;
+}
+
+/* Uniformly pick one of the num_free clear bits of used[]; the rank of the
+ * pick is located a word at a time with a population count */
+static int
+pick_free_timeslot(const uint32_t *used, uint16_t num_free, uint16_t length)
+{
+  uint16_t rank;
+  uint16_t word;
+  uint16_t words = (length + 31) / 32;
+  uint32_t free_bits;
+  uint8_t count;
+  uint8_t bit;
+
+  if(num_free == 0) {
+    return -1;
+  }
+
+  rank = random_rand() % num_free;
+  for(word = 0; word < words; word++) {
+    free_bits = ~used[word];
+    if(word == words - 1 && (length % 32) != 0) {
+      free_bits &= (1UL << (length % 32)) - 1;
+    }
+    count = __builtin_popcount(free_bits);
+    if(rank < count) {
+      for(bit = 0; bit < 32; bit++) {
+        if((free_bits & (1UL << bit)) && rank-- == 0) {
+          return word * 32 + bit;
+        }
+      }
+    }
+    rank -= count;
+  }
+  return -1;
+}
+
+/* Randomly draw candidate cells over the (timeslot, channel offset) grid.
+ * The timeslot is picked uniformly among the ones unused at any channel
+ * offset on our side, off a scratch copy of the occupancy bitmap so that no
+ * timeslot is proposed twice; the channel offset is drawn independently so
+ * concurrent cells of the neighbourhood spread over the hopping sequence. */
+static uint8_t
+draw_candidate_cells(struct tsch_slotframe *slotframe,
+                     sf_simple_cell_t *cell_list, uint8_t max_cells)
+{
+  sf_simple_occupancy_t *occ;
+  uint32_t used[OCCUPANCY_WORDS];
+  uint16_t num_free;
+  int random_slot;
+  uint8_t index = 0;
+
+  occ = get_occupancy(slotframe);
+  memcpy(used, occ->used, sizeof(used));
+  num_free = occ->num_free;
+
+  while(index < max_cells &&
+        (random_slot = pick_free_timeslot(used, num_free,
+                                          MIN(slotframe->size.val,
+                                              SF_SIMPLE_MAX_TIMESLOTS))) >= 0) {
+    used[random_slot / 32] |= 1UL << (random_slot % 32);
+    num_free--;
+
+    cell_list[index].timeslot_offset = random_slot;
+    cell_list[index].channel_offset =
+      random_rand() % SF_SIMPLE_NUM_CHANNEL_OFFSETS;
+    index++;
+  }
+  return index;
+}
+
+/* Returns the number of cells installed */
+static uint16_t
+add_links_to_schedule(struct tsch_slotframe *slotframe,
+                      const linkaddr_t *peer_addr, uint8_t link_option,
                       const uint8_t *cell_list, uint16_t cell_list_len)
 {
-  /* add only the first valid cell */
+  /* add every valid cell of the bundle */
 
   sf_simple_cell_t cell;
-  struct tsch_slotframe *slotframe;
+  uint16_t added = 0;
   int i;
 
   assert(cell_list != NULL);
 
-  slotframe = tsch_schedule_get_slotframe_by_handle(slotframe_handle);
-
   if(slotframe == NULL) {
-    return;
+    return 0;
   }
 
   for(i = 0; i < cell_list_len; i += sizeof(cell)) {
@@ -137,31 +681,49 @@ add_links_to_schedule(const linkaddr_t *peer_addr, uint8_t link_option,
     if(cell.timeslot_offset == 0xffff) {
       continue;
     }
+    /* a peer may grant cells off the slotframe, and a timeslot offered to
+     * another neighbour may have been taken since: never share one */
+    if(cell.timeslot_offset >= slotframe->size.val ||
+       timeslot_in_use(slotframe, cell.timeslot_offset)) {
+      PRINTF("sf-simple: Link %u/%u unavailable, not scheduled\r\r\n",
+             cell.timeslot_offset, slotframe->handle);
+      continue;
+    }
 
-    PRINTF("sf-simple: Schedule link %d as %s with node ",
-           cell.timeslot_offset,
+    PRINTF("sf-simple: Schedule link %d/%u as %s with node ",
+           cell.timeslot_offset, slotframe->handle,
            link_option == LINK_OPTION_RX ? "RX" : "TX");
     PRINTLLADDR((uip_lladdr_t *)peer_addr);
     PRINTF("\r\r\n");
-    tsch_schedule_add_link(slotframe,
-                           link_option, LINK_TYPE_NORMAL, peer_addr,
-                           cell.timeslot_offset, cell.channel_offset, 1);
-    break;
+    if(tsch_schedule_add_link(slotframe,
+                              link_option, LINK_TYPE_NORMAL, peer_addr,
+                              cell.timeslot_offset, cell.channel_offset,
+                              1) != NULL) {
+      occupancy_set(slotframe, cell.timeslot_offset);
+#if SF_SIMPLE_CELL_STATS
+      if(link_option == LINK_OPTION_TX) {
+        cell_stats_add(peer_addr, slotframe->handle, cell.timeslot_offset);
+      }
+#endif /* SF_SIMPLE_CELL_STATS */
+      added++;
+    }
   }
+  return added;
 }
 
 static void
-remove_links_to_schedule(const uint8_t *cell_list, uint16_t cell_list_len)
+remove_links_to_schedule(struct tsch_slotframe *slotframe,
+                         const linkaddr_t *peer_addr, uint8_t link_options,
+                         const uint8_t *cell_list, uint16_t cell_list_len)
 {
-  /* remove all the cells */
+  /* remove the cells shared with the peer, with these options on our side;
+   * a timeslot may as well carry a cell with another neighbour */
 
   sf_simple_cell_t cell;
-  struct tsch_slotframe *slotframe;
+  struct tsch_link *l;
   int i;
 
-  assert(cell_list != NULL);
-
-  slotframe = tsch_schedule_get_slotframe_by_handle(slotframe_handle);
+  assert(peer_addr != NULL && cell_list != NULL);
 
   if(slotframe == NULL) {
     return;
@@ -169,13 +731,20 @@ remove_links_to_schedule(const uint8_t *cell_list, uint16_t cell_list_len)
 
   for(i = 0; i < cell_list_len; i += sizeof(cell)) {
     read_cell(&cell_list[i], &cell);
-    if(cell.timeslot_offset == 0xffff) {
+    if(cell.timeslot_offset == 0xffff ||
+       (l = tsch_schedule_get_link_by_offsets(slotframe,
+                                              cell.timeslot_offset,
+                                              cell.channel_offset)) == NULL ||
+       l->link_options != link_options ||
+       !linkaddr_cmp(&l->addr, peer_addr)) {
       continue;
     }
 
-    tsch_schedule_remove_link_by_offsets(slotframe,
-                                         cell.timeslot_offset,
-                                         cell.channel_offset);
+    tsch_schedule_remove_link(slotframe, l);
+    occupancy_clear(slotframe, cell.timeslot_offset);
+#if SF_SIMPLE_CELL_STATS
+    cell_stats_remove(slotframe->handle, cell.timeslot_offset);
+#endif /* SF_SIMPLE_CELL_STATS */
   }
 }
 
@@ -189,6 +758,7 @@ add_response_sent_callback(void *arg, uint16_t arg_len,
   const uint8_t *cell_list;
   uint16_t cell_list_len;
   sixp_nbr_t *nbr;
+  sf_simple_trans_buf_t *buf;
 
   assert(body != NULL && dest_addr != NULL);
 
@@ -197,10 +767,13 @@ add_response_sent_callback(void *arg, uint16_t arg_len,
                             (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
                             &cell_list, &cell_list_len,
                             body, body_len) == 0 &&
-     (nbr = sixp_nbr_find(dest_addr)) != NULL) {
-    add_links_to_schedule(dest_addr, LINK_OPTION_RX,
+     (nbr = sixp_nbr_find(dest_addr)) != NULL &&
+     (buf = trans_buf_find_by_body(arg)) != NULL) {
+    add_links_to_schedule(get_slotframe(buf->slotframe_handle),
+                          dest_addr, LINK_OPTION_RX,
                           cell_list, cell_list_len);
   }
+  trans_buf_free_by_body(arg);
 }
 
 static void
@@ -213,6 +786,35 @@ delete_response_sent_callback(void *arg, uint16_t arg_len,
   const uint8_t *cell_list;
   uint16_t cell_list_len;
   sixp_nbr_t *nbr;
+  sf_simple_trans_buf_t *buf;
+
+  assert(body != NULL && dest_addr != NULL);
+
+  if(status == SIXP_OUTPUT_STATUS_SUCCESS &&
+     sixp_pkt_get_cell_list(SIXP_PKT_TYPE_RESPONSE,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                            &cell_list, &cell_list_len,
+                            body, body_len) == 0 &&
+     (nbr = sixp_nbr_find(dest_addr)) != NULL &&
+     (buf = trans_buf_find_by_body(arg)) != NULL) {
+    remove_links_to_schedule(get_slotframe(buf->slotframe_handle),
+                             dest_addr, buf->link_options,
+                             cell_list, cell_list_len);
+  }
+  trans_buf_free_by_body(arg);
+}
+
+static void
+relocate_response_sent_callback(void *arg, uint16_t arg_len,
+                                const linkaddr_t *dest_addr,
+                                sixp_output_status_t status)
+{
+  uint8_t *body = (uint8_t *)arg;
+  uint16_t body_len = arg_len;
+  const uint8_t *cell_list;
+  uint16_t cell_list_len;
+  sixp_nbr_t *nbr;
+  sf_simple_trans_buf_t *buf;
 
   assert(body != NULL && dest_addr != NULL);
 
@@ -221,9 +823,30 @@ delete_response_sent_callback(void *arg, uint16_t arg_len,
                             (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
                             &cell_list, &cell_list_len,
                             body, body_len) == 0 &&
-     (nbr = sixp_nbr_find(dest_addr)) != NULL) {
-    remove_links_to_schedule(cell_list, cell_list_len);
+     (nbr = sixp_nbr_find(dest_addr)) != NULL &&
+     (buf = trans_buf_find_by_body(arg)) != NULL) {
+    remove_links_to_schedule(get_slotframe(buf->slotframe_handle),
+                             dest_addr, buf->link_options,
+                             buf->aux, buf->aux_len);
+    add_links_to_schedule(get_slotframe(buf->slotframe_handle),
+                          dest_addr, LINK_OPTION_RX,
+                          cell_list, cell_list_len);
   }
+  trans_buf_free_by_body(arg);
+}
+
+/* Out of transaction buffers: let the peer back off and retry later */
+static void
+send_busy_response(const linkaddr_t *peer_addr)
+{
+  PRINTF("sf-simple: No transaction buffer left, busy for node ");
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF("\r\r\n");
+  sixp_output(SIXP_PKT_TYPE_RESPONSE,
+              (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_ERR_BUSY,
+              SF_SIMPLE_SFID,
+              NULL, 0, peer_addr,
+              NULL, NULL, 0);
 }
 
 static void
@@ -237,6 +860,7 @@ add_req_input(const uint8_t *body, uint16_t body_len, const linkaddr_t *peer_add
   const uint8_t *cell_list;
   uint16_t cell_list_len;
   uint16_t res_len;
+  sf_simple_trans_buf_t *buf;
 
   assert(body != NULL && peer_addr != NULL);
 
@@ -259,44 +883,55 @@ add_req_input(const uint8_t *body, uint16_t body_len, const linkaddr_t *peer_add
   print_cell_list(cell_list, cell_list_len);
   PRINTF("\r\r\n");
 
-  slotframe = tsch_schedule_get_slotframe_by_handle(slotframe_handle);
-  if(slotframe == NULL) {
+  if((slotframe = get_request_slotframe(SIXP_PKT_CMD_ADD,
+                                         body, body_len)) == NULL) {
+    PRINTF("sf-simple: Unknown slotframe in add request\r\r\n");
     return;
   }
 
   if(num_cells > 0 && cell_list_len > 0) {
-    memset(res_storage, 0, sizeof(res_storage));
+    if((buf = trans_buf_alloc(peer_addr)) == NULL) {
+      send_busy_response(peer_addr);
+      return;
+    }
+    buf->slotframe_handle = slotframe->handle;
     res_len = 0;
 
     /* checking availability for requested slots */
     for(i = 0, feasible_link = 0;
-        i < cell_list_len && feasible_link < num_cells;
+        i < cell_list_len && feasible_link < num_cells &&
+        res_len < sizeof(buf->body);
         i += sizeof(cell)) {
       read_cell(&cell_list[i], &cell);
-      if(tsch_schedule_get_link_by_offsets(slotframe,
-                                           cell.timeslot_offset,
-                                           cell.channel_offset) == NULL) {
+      if(cell.timeslot_offset < slotframe->size.val &&
+         cell.channel_offset < SF_SIMPLE_NUM_CHANNEL_OFFSETS &&
+         !timeslot_in_use(slotframe, cell.timeslot_offset) &&
+         !cell_list_has_timeslot(buf->body, res_len,
+                                 cell.timeslot_offset)) {
         sixp_pkt_set_cell_list(SIXP_PKT_TYPE_RESPONSE,
                                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
                                (uint8_t *)&cell, sizeof(cell),
-                               feasible_link,
-                               res_storage, sizeof(res_storage));
+                               res_len,
+                               buf->body, sizeof(buf->body));
         res_len += sizeof(cell);
         feasible_link++;
       }
     }
 
-    if(feasible_link == num_cells) {
-      /* Links are feasible. Create Link Response packet */
-      PRINTF("sf-simple: Send a 6P Response to node ");
-      PRINTLLADDR((uip_lladdr_t *)peer_addr);
-      PRINTF("\r\r\n");
-      
-      sixp_output(SIXP_PKT_TYPE_RESPONSE,
-                  (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
-                  SF_SIMPLE_SFID,
-                  res_storage, res_len, peer_addr,
-                  add_response_sent_callback, res_storage, res_len);
+    /* Create Link Response packet with the feasible part of the bundle */
+    PRINTF("sf-simple: Send a 6P Response with %d of %d links to node ",
+           feasible_link, num_cells);
+    PRINTLLADDR((uip_lladdr_t *)peer_addr);
+    PRINTF("\r\r\n");
+
+    buf->body_len = res_len;
+    if(sixp_output(SIXP_PKT_TYPE_RESPONSE,
+                   (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                   SF_SIMPLE_SFID,
+                   buf->body, buf->body_len, peer_addr,
+                   add_response_sent_callback,
+                   buf->body, buf->body_len) < 0) {
+      trans_buf_free(buf);
     }
   }
 }
@@ -308,15 +943,22 @@ delete_req_input(const uint8_t *body, uint16_t body_len,
   uint8_t i;
   sf_simple_cell_t cell;
   struct tsch_slotframe *slotframe;
+  struct tsch_link *l;
+  sixp_pkt_cell_options_t cell_options;
+  uint8_t link_options;
   uint8_t num_cells;
   const uint8_t *cell_list;
   uint16_t cell_list_len;
   uint16_t res_len;
-  int removed_link;
+  sf_simple_trans_buf_t *buf;
 
   assert(body != NULL && peer_addr != NULL);
 
-  if(sixp_pkt_get_num_cells(SIXP_PKT_TYPE_REQUEST,
+  if(sixp_pkt_get_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                               &cell_options,
+                               body, body_len) != 0 ||
+     sixp_pkt_get_num_cells(SIXP_PKT_TYPE_REQUEST,
                             (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
                             &num_cells,
                             body, body_len) != 0 ||
@@ -335,26 +977,37 @@ delete_req_input(const uint8_t *body, uint16_t body_len,
   print_cell_list(cell_list, cell_list_len);
   PRINTF("\r\r\n");
 
-  slotframe = tsch_schedule_get_slotframe_by_handle(slotframe_handle);
-  if(slotframe == NULL) {
+  if((slotframe = get_request_slotframe(SIXP_PKT_CMD_DELETE,
+                                         body, body_len)) == NULL) {
+    PRINTF("sf-simple: Unknown slotframe in delete request\r\r\n");
     return;
   }
 
-  memset(res_storage, 0, sizeof(res_storage));
+  if((buf = trans_buf_alloc(peer_addr)) == NULL) {
+    send_busy_response(peer_addr);
+    return;
+  }
+  link_options = cell_options_to_link_options(cell_options);
+  buf->slotframe_handle = slotframe->handle;
+  buf->link_options = link_options;
   res_len = 0;
 
   if(num_cells > 0 && cell_list_len > 0) {
-    /* ensure before delete */
-    for(i = 0, removed_link = 0; i < cell_list_len; i += sizeof(cell)) {
+    /* only cells shared with the requester, with mirrored options: the
+     * timeslot may carry our own cell with another neighbour */
+    for(i = 0; i < cell_list_len && res_len < sizeof(buf->body);
+        i += sizeof(cell)) {
       read_cell(&cell_list[i], &cell);
-      if(tsch_schedule_get_link_by_offsets(slotframe,
-                                           cell.timeslot_offset,
-                                           cell.channel_offset) != NULL) {
+      if((l = tsch_schedule_get_link_by_offsets(slotframe,
+                                                cell.timeslot_offset,
+                                                cell.channel_offset)) != NULL &&
+         l->link_options == link_options &&
+         linkaddr_cmp(&l->addr, peer_addr)) {
         sixp_pkt_set_cell_list(SIXP_PKT_TYPE_RESPONSE,
                                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
                                (uint8_t *)&cell, sizeof(cell),
-                               removed_link,
-                               res_storage, sizeof(res_storage));
+                               res_len,
+                               buf->body, sizeof(buf->body));
         res_len += sizeof(cell);
       }
     }
@@ -364,82 +1017,457 @@ delete_req_input(const uint8_t *body, uint16_t body_len,
   PRINTF("sf-simple: Send a 6P Response to node ");
   PRINTLLADDR((uip_lladdr_t *)peer_addr);
   PRINTF("\r\r\n");
-  sixp_output(SIXP_PKT_TYPE_RESPONSE,
-              (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
-              SF_SIMPLE_SFID,
-              res_storage, res_len, peer_addr,
-              delete_response_sent_callback, res_storage, res_len);
-}
-
-static void
-input(sixp_pkt_type_t type, sixp_pkt_code_t code,
-      const uint8_t *body, uint16_t body_len, const linkaddr_t *src_addr)
-{
-  assert(body != NULL && body != NULL);
-  switch(type) {
-    case SIXP_PKT_TYPE_REQUEST:
-      request_input(code.cmd, body, body_len, src_addr);
-      break;
-    case SIXP_PKT_TYPE_RESPONSE:
-      response_input(code.rc, body, body_len, src_addr);
-      break;
-    default:
-      /* unsupported */
-      break;
+  buf->body_len = res_len;
+  if(sixp_output(SIXP_PKT_TYPE_RESPONSE,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                 SF_SIMPLE_SFID,
+                 buf->body, buf->body_len, peer_addr,
+                 delete_response_sent_callback,
+                 buf->body, buf->body_len) < 0) {
+    trans_buf_free(buf);
   }
 }
 
 static void
-request_input(sixp_pkt_cmd_t cmd,
-              const uint8_t *body, uint16_t body_len,
-              const linkaddr_t *peer_addr)
+relocate_req_input(const uint8_t *body, uint16_t body_len,
+                   const linkaddr_t *peer_addr)
 {
+  uint8_t i;
+  sf_simple_cell_t cell;
+  struct tsch_slotframe *slotframe;
+  struct tsch_link *l;
+  sixp_pkt_cell_options_t cell_options;
+  uint8_t link_options;
+  uint8_t num_cells;
+  const uint8_t *rel_cell_list;
+  uint16_t rel_cell_list_len;
+  const uint8_t *cand_cell_list;
+  uint16_t cand_cell_list_len;
+  uint16_t res_len;
+  sf_simple_trans_buf_t *buf;
+
   assert(body != NULL && peer_addr != NULL);
 
-  switch(cmd) {
-    case SIXP_PKT_CMD_ADD:
-      add_req_input(body, body_len, peer_addr);
-      break;
-    case SIXP_PKT_CMD_DELETE:
-      delete_req_input(body, body_len, peer_addr);
-      break;
-    default:
-      /* unsupported request */
-      break;
+  if(sixp_pkt_get_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                               &cell_options,
+                               body, body_len) != 0 ||
+     sixp_pkt_get_num_cells(SIXP_PKT_TYPE_REQUEST,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                            &num_cells,
+                            body, body_len) != 0 ||
+     sixp_pkt_get_rel_cell_list(SIXP_PKT_TYPE_REQUEST,
+                                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                                &rel_cell_list, &rel_cell_list_len,
+                                body, body_len) != 0 ||
+     sixp_pkt_get_cand_cell_list(SIXP_PKT_TYPE_REQUEST,
+                                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                                 &cand_cell_list, &cand_cell_list_len,
+                                 body, body_len) != 0) {
+    PRINTF("sf-simple: Parse error on relocate request\r\r\n");
+    return;
   }
-}
-static void
-response_input(sixp_pkt_rc_t rc,
-               const uint8_t *body, uint16_t body_len,
-               const linkaddr_t *peer_addr)
-{
-  const uint8_t *cell_list;
-  uint16_t cell_list_len;
-  sixp_nbr_t *nbr;
-  sixp_trans_t *trans;
 
-  assert(body != NULL && peer_addr != NULL);
+  PRINTF("sf-simple: Received a 6P Relocate Request for %d links from node ",
+         num_cells);
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF(" with LinkList : ");
+  print_cell_list(rel_cell_list, rel_cell_list_len);
+  PRINTF(" CandidateList : ");
+  print_cell_list(cand_cell_list, cand_cell_list_len);
+  PRINTF("\r\r\n");
 
-  if((nbr = sixp_nbr_find(peer_addr)) == NULL ||
-     (trans = sixp_trans_find(peer_addr)) == NULL) {
+  if((slotframe = get_request_slotframe(SIXP_PKT_CMD_RELOCATE,
+                                         body, body_len)) == NULL) {
+    PRINTF("sf-simple: Unknown slotframe in relocate request\r\r\n");
     return;
   }
 
-  if(rc == SIXP_PKT_RC_SUCCESS) {
-    switch(sixp_trans_get_cmd(trans)) {
-      case SIXP_PKT_CMD_ADD:
-        if(sixp_pkt_get_cell_list(SIXP_PKT_TYPE_RESPONSE,
-                                  (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+  /* every cell to relocate must be one we share with the requester,
+   * with mirrored options */
+  link_options = cell_options_to_link_options(cell_options);
+  for(i = 0; i < rel_cell_list_len; i += sizeof(cell)) {
+    read_cell(&rel_cell_list[i], &cell);
+    if((l = tsch_schedule_get_link_by_offsets(slotframe,
+                                              cell.timeslot_offset,
+                                              cell.channel_offset)) == NULL ||
+       l->link_options != link_options ||
+       !linkaddr_cmp(&l->addr, peer_addr)) {
+      PRINTF("sf-simple: Unknown cell (%u,%u) to relocate\r\r\n",
+             cell.timeslot_offset, cell.channel_offset);
+      sixp_output(SIXP_PKT_TYPE_RESPONSE,
+                  (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_ERR_CELLLIST,
+                  SF_SIMPLE_SFID,
+                  NULL, 0, peer_addr,
+                  NULL, NULL, 0);
+      return;
+    }
+  }
+
+  if((buf = trans_buf_alloc(peer_addr)) == NULL) {
+    send_busy_response(peer_addr);
+    return;
+  }
+  buf->slotframe_handle = slotframe->handle;
+  buf->link_options = link_options;
+  res_len = 0;
+
+  /* the i-th available candidate replaces the i-th cell to relocate */
+  for(i = 0;
+      i < cand_cell_list_len && res_len < rel_cell_list_len &&
+      res_len < num_cells * sizeof(cell) && res_len < sizeof(buf->aux);
+      i += sizeof(cell)) {
+    read_cell(&cand_cell_list[i], &cell);
+    if(cell.timeslot_offset < slotframe->size.val &&
+       cell.channel_offset < SF_SIMPLE_NUM_CHANNEL_OFFSETS &&
+       !timeslot_in_use(slotframe, cell.timeslot_offset) &&
+       !cell_list_has_timeslot(buf->body, res_len, cell.timeslot_offset)) {
+      sixp_pkt_set_cell_list(SIXP_PKT_TYPE_RESPONSE,
+                             (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                             (uint8_t *)&cell, sizeof(cell),
+                             res_len,
+                             buf->body, sizeof(buf->body));
+      memcpy(&buf->aux[res_len], &rel_cell_list[res_len], sizeof(cell));
+      res_len += sizeof(cell);
+    }
+  }
+
+  PRINTF("sf-simple: Send a 6P Relocate Response with %d of %d links to node ",
+         (int)(res_len / sizeof(cell)), num_cells);
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF("\r\r\n");
+
+  buf->body_len = res_len;
+  buf->aux_len = res_len;
+  if(sixp_output(SIXP_PKT_TYPE_RESPONSE,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                 SF_SIMPLE_SFID,
+                 buf->body, buf->body_len, peer_addr,
+                 relocate_response_sent_callback,
+                 buf->body, buf->body_len) < 0) {
+    trans_buf_free(buf);
+  }
+}
+
+/* Link options on our side of the cells a requester designates with its
+ * own cell options */
+static uint8_t
+cell_options_to_link_options(sixp_pkt_cell_options_t options)
+{
+  uint8_t link_options = 0;
+
+  if(options & SIXP_PKT_CELL_OPTION_TX) {
+    link_options |= LINK_OPTION_RX;
+  }
+  if(options & SIXP_PKT_CELL_OPTION_RX) {
+    link_options |= LINK_OPTION_TX;
+  }
+  if(options & SIXP_PKT_CELL_OPTION_SHARED) {
+    link_options |= LINK_OPTION_SHARED;
+  }
+  return link_options;
+}
+
+static uint16_t
+count_links_with(struct tsch_slotframe *slotframe,
+                 const linkaddr_t *peer_addr, uint8_t link_options)
+{
+  struct tsch_link *l;
+  uint16_t count = 0;
+
+  if(slotframe == NULL) {
+    return 0;
+  }
+
+  for(l = list_head(slotframe->links_list); l != NULL; l = list_item_next(l)) {
+    if(l->link_options == link_options && linkaddr_cmp(&l->addr, peer_addr)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+static void
+count_req_input(const uint8_t *body, uint16_t body_len,
+                const linkaddr_t *peer_addr)
+{
+  sixp_pkt_cell_options_t cell_options;
+  struct tsch_slotframe *slotframe;
+  uint16_t total;
+  uint8_t res_body[sizeof(sixp_pkt_total_num_cells_t)];
+
+  assert(body != NULL && peer_addr != NULL);
+
+  if(sixp_pkt_get_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_COUNT,
+                               &cell_options,
+                               body, body_len) != 0) {
+    PRINTF("sf-simple: Parse error on count request\r\r\n");
+    return;
+  }
+
+  if((slotframe = get_request_slotframe(SIXP_PKT_CMD_COUNT,
+                                         body, body_len)) == NULL) {
+    PRINTF("sf-simple: Unknown slotframe in count request\r\r\n");
+    return;
+  }
+
+  total = count_links_with(slotframe, peer_addr,
+                           cell_options_to_link_options(cell_options));
+
+  PRINTF("sf-simple: Send a 6P Count Response (%u links) to node ", total);
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF("\r\r\n");
+
+  memset(res_body, 0, sizeof(res_body));
+  if(sixp_pkt_set_total_num_cells(SIXP_PKT_TYPE_RESPONSE,
+                                  (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                                  total,
+                                  res_body, sizeof(res_body)) != 0) {
+    PRINTF("sf-simple: Build error on count response\r\r\n");
+    return;
+  }
+  sixp_output(SIXP_PKT_TYPE_RESPONSE,
+              (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+              SF_SIMPLE_SFID,
+              res_body, sizeof(res_body), peer_addr,
+              NULL, NULL, 0);
+}
+
+static void
+list_req_input(const uint8_t *body, uint16_t body_len,
+               const linkaddr_t *peer_addr)
+{
+  sixp_pkt_cell_options_t cell_options;
+  sixp_pkt_offset_t offset;
+  sixp_pkt_max_num_cells_t max_num_cells;
+  struct tsch_slotframe *slotframe;
+  struct tsch_link *l;
+  uint8_t link_options;
+  sf_simple_cell_t cell;
+  uint8_t res_body[SF_SIMPLE_MAX_LINKS * sizeof(sf_simple_cell_t)];
+  uint16_t res_len = 0;
+  uint16_t index = 0;
+  sixp_pkt_rc_t rc = SIXP_PKT_RC_EOL;
+
+  assert(body != NULL && peer_addr != NULL);
+
+  if(sixp_pkt_get_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_LIST,
+                               &cell_options,
+                               body, body_len) != 0 ||
+     sixp_pkt_get_offset(SIXP_PKT_TYPE_REQUEST,
+                         (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_LIST,
+                         &offset,
+                         body, body_len) != 0 ||
+     sixp_pkt_get_max_num_cells(SIXP_PKT_TYPE_REQUEST,
+                                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_LIST,
+                                &max_num_cells,
+                                body, body_len) != 0) {
+    PRINTF("sf-simple: Parse error on list request\r\r\n");
+    return;
+  }
+
+  if((slotframe = get_request_slotframe(SIXP_PKT_CMD_LIST,
+                                         body, body_len)) == NULL) {
+    PRINTF("sf-simple: Unknown slotframe in list request\r\r\n");
+    return;
+  }
+
+  /* one page of at most max_num_cells cells; EOL once nothing is left */
+  link_options = cell_options_to_link_options(cell_options);
+  for(l = list_head(slotframe->links_list); l != NULL; l = list_item_next(l)) {
+    if(l->link_options != link_options || !linkaddr_cmp(&l->addr, peer_addr)) {
+      continue;
+    }
+    if(index++ < offset) {
+      continue;
+    }
+    if(res_len / sizeof(cell) >= max_num_cells ||
+       res_len >= sizeof(res_body)) {
+      rc = SIXP_PKT_RC_SUCCESS;
+      break;
+    }
+    cell.timeslot_offset = l->timeslot;
+    cell.channel_offset = l->channel_offset;
+    sixp_pkt_set_cell_list(SIXP_PKT_TYPE_RESPONSE,
+                           (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                           (uint8_t *)&cell, sizeof(cell),
+                           res_len,
+                           res_body, sizeof(res_body));
+    res_len += sizeof(cell);
+  }
+
+  PRINTF("sf-simple: Send a 6P List Response from offset %u with LinkList : ",
+         offset);
+  print_cell_list(res_body, res_len);
+  PRINTF("%sto node ", rc == SIXP_PKT_RC_EOL ? "(EOL) " : "");
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF("\r\r\n");
+
+  sixp_output(SIXP_PKT_TYPE_RESPONSE,
+              (sixp_pkt_code_t)(uint8_t)rc,
+              SF_SIMPLE_SFID,
+              res_body, res_len, peer_addr,
+              NULL, NULL, 0);
+}
+
+static void
+clear_req_input(const uint8_t *body, uint16_t body_len,
+                const linkaddr_t *peer_addr)
+{
+  assert(body != NULL && peer_addr != NULL);
+
+  PRINTF("sf-simple: Received a 6P Clear Request from node ");
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF("\r\r\n");
+
+  remove_all_links_with(peer_addr);
+  sixp_output(SIXP_PKT_TYPE_RESPONSE,
+              (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+              SF_SIMPLE_SFID,
+              NULL, 0, peer_addr,
+              NULL, NULL, 0);
+}
+
+static void
+input(sixp_pkt_type_t type, sixp_pkt_code_t code,
+      const uint8_t *body, uint16_t body_len, const linkaddr_t *src_addr)
+{
+  assert(body != NULL && body != NULL);
+  switch(type) {
+    case SIXP_PKT_TYPE_REQUEST:
+      request_input(code.cmd, body, body_len, src_addr);
+      break;
+    case SIXP_PKT_TYPE_RESPONSE:
+      response_input(code.rc, body, body_len, src_addr);
+      break;
+    default:
+      /* unsupported */
+      break;
+  }
+}
+
+static void
+request_input(sixp_pkt_cmd_t cmd,
+              const uint8_t *body, uint16_t body_len,
+              const linkaddr_t *peer_addr)
+{
+  assert(body != NULL && peer_addr != NULL);
+
+  switch(cmd) {
+    case SIXP_PKT_CMD_ADD:
+      add_req_input(body, body_len, peer_addr);
+      break;
+    case SIXP_PKT_CMD_DELETE:
+      delete_req_input(body, body_len, peer_addr);
+      break;
+    case SIXP_PKT_CMD_RELOCATE:
+      relocate_req_input(body, body_len, peer_addr);
+      break;
+    case SIXP_PKT_CMD_COUNT:
+      count_req_input(body, body_len, peer_addr);
+      break;
+    case SIXP_PKT_CMD_LIST:
+      list_req_input(body, body_len, peer_addr);
+      break;
+    case SIXP_PKT_CMD_CLEAR:
+      clear_req_input(body, body_len, peer_addr);
+      break;
+    default:
+      /* unsupported request */
+      break;
+  }
+}
+static void
+response_input(sixp_pkt_rc_t rc,
+               const uint8_t *body, uint16_t body_len,
+               const linkaddr_t *peer_addr)
+{
+  const uint8_t *cell_list;
+  uint16_t cell_list_len;
+  const uint8_t *rel_cell_list;
+  uint16_t rel_cell_list_len;
+  const uint8_t *req_cell_list;
+  uint16_t req_cell_list_len;
+  sf_simple_cell_t cell;
+  uint16_t i;
+  sixp_nbr_t *nbr;
+  sixp_trans_t *trans;
+  sf_simple_request_t *req;
+  sf_simple_trans_buf_t *buf;
+  struct tsch_slotframe *slotframe;
+  uint16_t added;
+
+  assert(body != NULL && peer_addr != NULL);
+
+  /* the body of our request, released once the response is handled */
+  buf = trans_buf_find(peer_addr);
+  slotframe = get_slotframe(buf != NULL ? buf->slotframe_handle :
+                            data_slotframe_handle(peer_addr));
+
+  if((nbr = sixp_nbr_find(peer_addr)) == NULL ||
+     (trans = sixp_trans_find(peer_addr)) == NULL) {
+    trans_buf_free(buf);
+    return;
+  }
+
+  /* only a tracked request waiting for this very response is concerned */
+  if((req = request_find(peer_addr)) != NULL && !req->pending) {
+    req = NULL;
+  }
+  if(req != NULL) {
+    req->pending = 0;
+  }
+
+  if(rc != SIXP_PKT_RC_SUCCESS &&
+     !(rc == SIXP_PKT_RC_EOL &&
+       sixp_trans_get_cmd(trans) == SIXP_PKT_CMD_LIST)) {
+    PRINTF("sf-simple: 6P request %u rejected with rc %u by node ",
+           sixp_trans_get_cmd(trans), rc);
+    PRINTLLADDR((uip_lladdr_t *)peer_addr);
+    PRINTF("\r\r\n");
+    trans_buf_free(buf);
+#if SF_SIMPLE_CELL_STATS
+    cell_stats_relocation_done(peer_addr);
+#endif /* SF_SIMPLE_CELL_STATS */
+    if(rc == SIXP_PKT_RC_ERR_SEQNUM || rc == SIXP_PKT_RC_RESET) {
+      /* the two schedules can no longer be trusted to match */
+      remove_all_links_with(peer_addr);
+    }
+    if(req != NULL) {
+      /* ERR_BUSY, ERR_LOCKED and the other errors are worth another try */
+      request_retry(req);
+    } else if(rc == SIXP_PKT_RC_ERR_CELLLIST &&
+              sixp_trans_get_cmd(trans) == SIXP_PKT_CMD_RELOCATE) {
+      /* the peer does not know the cell we wanted to move: check the rest */
+      request_defer(peer_addr, SIXP_PKT_CMD_COUNT);
+    }
+    return;
+  }
+
+  if(rc == SIXP_PKT_RC_SUCCESS || rc == SIXP_PKT_RC_EOL) {
+    switch(sixp_trans_get_cmd(trans)) {
+      case SIXP_PKT_CMD_ADD:
+        if(sixp_pkt_get_cell_list(SIXP_PKT_TYPE_RESPONSE,
+                                  (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
                                   &cell_list, &cell_list_len,
                                   body, body_len) != 0) {
           PRINTF("sf-simple: Parse error on add response\r\r\n");
-          return;
+          break;
         }
         PRINTF("sf-simple: Received a 6P Add Response with LinkList : ");
         print_cell_list(cell_list, cell_list_len);
         PRINTF("\r\r\n");
-        add_links_to_schedule(peer_addr, LINK_OPTION_TX,
-                              cell_list, cell_list_len);
+        added = add_links_to_schedule(slotframe, peer_addr, LINK_OPTION_TX,
+                                      cell_list, cell_list_len);
+        if(req != NULL && added < req->num_links) {
+          /* partial grant: go on for the remaining cells after a back-off */
+          req->num_links -= added;
+          request_retry(req);
+        } else {
+          request_done(peer_addr);
+        }
         break;
       case SIXP_PKT_CMD_DELETE:
         if(sixp_pkt_get_cell_list(SIXP_PKT_TYPE_RESPONSE,
@@ -447,20 +1475,74 @@ response_input(sixp_pkt_rc_t rc,
                                   &cell_list, &cell_list_len,
                                   body, body_len) != 0) {
           PRINTF("sf-simple: Parse error on add response\r\r\n");
-          return;
+          break;
         }
         PRINTF("sf-simple: Received a 6P Delete Response with LinkList : ");
         print_cell_list(cell_list, cell_list_len);
         PRINTF("\r\r\n");
-        remove_links_to_schedule(cell_list, cell_list_len);
+        /* only the cells we asked for go, whatever else the peer lists */
+        if(buf != NULL &&
+           sixp_pkt_get_cell_list(SIXP_PKT_TYPE_REQUEST,
+                                  (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                                  &req_cell_list, &req_cell_list_len,
+                                  buf->body, buf->body_len) == 0) {
+          for(i = 0; i + sizeof(cell) <= cell_list_len; i += sizeof(cell)) {
+            read_cell(&cell_list[i], &cell);
+            if(cell_list_has_cell(req_cell_list, req_cell_list_len, &cell)) {
+              remove_links_to_schedule(slotframe, peer_addr, LINK_OPTION_TX,
+                                       &cell_list[i], sizeof(cell));
+            }
+          }
+        }
+        request_done(peer_addr);
+        break;
+      case SIXP_PKT_CMD_RELOCATE:
+        if(sixp_pkt_get_cell_list(SIXP_PKT_TYPE_RESPONSE,
+                                  (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                                  &cell_list, &cell_list_len,
+                                  body, body_len) != 0 ||
+           buf == NULL ||
+           sixp_pkt_get_rel_cell_list(SIXP_PKT_TYPE_REQUEST,
+                                      (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                                      &rel_cell_list, &rel_cell_list_len,
+                                      buf->body, buf->body_len) != 0) {
+          PRINTF("sf-simple: Parse error on relocate response\r\r\n");
+          break;
+        }
+        PRINTF("sf-simple: Received a 6P Relocate Response with LinkList : ");
+        print_cell_list(cell_list, cell_list_len);
+        PRINTF("\r\r\n");
+        /* the first cells of our relocation list moved to the new ones */
+        remove_links_to_schedule(slotframe, peer_addr, LINK_OPTION_TX,
+                                 rel_cell_list,
+                                 MIN(rel_cell_list_len, cell_list_len));
+        add_links_to_schedule(slotframe, peer_addr, LINK_OPTION_TX,
+                              cell_list, MIN(rel_cell_list_len, cell_list_len));
         break;
       case SIXP_PKT_CMD_COUNT:
+        count_res_input(req, body, body_len, peer_addr);
+        break;
       case SIXP_PKT_CMD_LIST:
+        list_res_input(req, rc, body, body_len, peer_addr);
+        break;
       case SIXP_PKT_CMD_CLEAR:
+        /* our side was cleared when the request went out */
+        PRINTF("sf-simple: Received a 6P Clear Response\r\r\n");
+        request_done(peer_addr);
+        break;
       default:
         PRINTF("sf-simple: unsupported response\r\r\n");
     }
   }
+
+  trans_buf_free(buf);
+#if SF_SIMPLE_CELL_STATS
+  cell_stats_relocation_done(peer_addr);
+#endif /* SF_SIMPLE_CELL_STATS */
+#if SF_SIMPLE_AUTONOMOUS
+  /* negotiated cells to the parent may have come or gone */
+  autonomous_update();
+#endif /* SF_SIMPLE_AUTONOMOUS */
 }
 /*---------------------------------------------------------------------------*/
 /* Initiates a Sixtop Link addition
@@ -468,86 +1550,74 @@ response_input(sixp_pkt_rc_t rc,
 int
 sf_simple_add_links(linkaddr_t *peer_addr, uint8_t num_links)
 {
-  uint8_t i = 0, index = 0;
-  struct tsch_slotframe *sf =
-    tsch_schedule_get_slotframe_by_handle(slotframe_handle);
+  uint8_t index;
+  struct tsch_slotframe *sf = get_slotframe(data_slotframe_handle(peer_addr));
 
   uint8_t req_len;
   sf_simple_cell_t cell_list[SF_SIMPLE_MAX_LINKS];
-
-  /* Flag to prevent repeated slots */
-  uint8_t slot_check = 1;
-  uint16_t random_slot = 0;
+  sf_simple_trans_buf_t *buf;
 
   assert(peer_addr != NULL && sf != NULL);
 
-  do {
-    /* Randomly select a slot offset within TSCH_SCHEDULE_DEFAULT_LENGTH */
-    random_slot = ((random_rand() & 0xFF)) % TSCH_SCHEDULE_DEFAULT_LENGTH;
+  if(num_links == 0 || num_links > SF_SIMPLE_MAX_LINKS ||
+     sixp_trans_find(peer_addr) != NULL) {
+    return -1;
+  }
 
-    if(tsch_schedule_get_link_by_offsets(sf, random_slot, 0) == NULL) {
+  index = draw_candidate_cells(sf, cell_list, SF_SIMPLE_MAX_LINKS);
 
-      /* To prevent repeated slots */
-      for(i = 0; i < index; i++) {
-        if(cell_list[i].timeslot_offset != random_slot) {
-          /* Random selection resulted in a free slot */
-          if(i == index - 1) { /* Checked till last index of link list */
-            slot_check = 1;
-            break;
-          }
-        } else {
-          /* Slot already present in CandidateLinkList */
-          slot_check++;
-          break;
-        }
-      }
+  /* Create a Sixtop Add Request. Return 0 if Success */
+  if(index == 0) {
+    PRINTF("sf-simple:! No free slot left\r\r\n");
+    return -1;
+  }
 
-      /* Random selection resulted in a free slot, add it to linklist */
-      if(slot_check == 1) {
-        cell_list[index].timeslot_offset = random_slot;
-        cell_list[index].channel_offset = 0;
-
-        index++;
-        slot_check++;
-      } else if(slot_check > TSCH_SCHEDULE_DEFAULT_LENGTH) {
-        PRINTF("sf-simple:! Number of trials for free slot exceeded...\r\r\n");
-        return -1;
-        break; /* exit while loop */
-      }
-    }
-  } while(index < SF_SIMPLE_MAX_LINKS);
+  /* Never ask for more cells than we could propose */
+  if(num_links > index) {
+    num_links = index;
+  }
 
-  /* Create a Sixtop Add Request. Return 0 if Success */
-  if(index == 0 ) {
+  if((buf = trans_buf_alloc(peer_addr)) == NULL) {
+    PRINTF("sf-simple: No transaction buffer left\r\r\n");
     return -1;
   }
 
-  memset(req_storage, 0, sizeof(req_storage));
-  if(sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST,
+  buf->slotframe_handle = sf->handle;
+  if(set_request_slotframe(SIXP_PKT_CMD_ADD, sf->handle,
+                           buf->body, sizeof(buf->body)) != 0 ||
+     sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST,
                                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
                                SIXP_PKT_CELL_OPTION_TX,
-                               req_storage,
-                               sizeof(req_storage)) != 0 ||
+                               buf->body,
+                               sizeof(buf->body)) != 0 ||
      sixp_pkt_set_num_cells(SIXP_PKT_TYPE_REQUEST,
                             (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
                             num_links,
-                            req_storage,
-                            sizeof(req_storage)) != 0 ||
+                            buf->body,
+                            sizeof(buf->body)) != 0 ||
      sixp_pkt_set_cell_list(SIXP_PKT_TYPE_REQUEST,
                             (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
                             (const uint8_t *)cell_list,
                             index * sizeof(sf_simple_cell_t), 0,
-                            req_storage, sizeof(req_storage)) != 0) {
+                            buf->body, sizeof(buf->body)) != 0) {
     PRINTF("sf-simple: Build error on add request\r\r\n");
+    trans_buf_free(buf);
     return -1;
   }
 
   /* The length of fixed part is 4 bytes: Metadata, CellOptions, and NumCells */
   req_len = 4 + index * sizeof(sf_simple_cell_t);
-  sixp_output(SIXP_PKT_TYPE_REQUEST, (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
-              SF_SIMPLE_SFID,
-              req_storage, req_len, peer_addr,
-              NULL, NULL, 0);
+  buf->body_len = req_len;
+  if(sixp_output(SIXP_PKT_TYPE_REQUEST,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
+                 SF_SIMPLE_SFID,
+                 buf->body, buf->body_len, peer_addr,
+                 NULL, NULL, 0) < 0) {
+    trans_buf_free(buf);
+    return -1;
+  }
+
+  request_started(peer_addr, SIXP_PKT_CMD_ADD, num_links);
 
   PRINTF("sf-simple: Send a 6P Add Request for %d links to node ",
          num_links);
@@ -564,28 +1634,30 @@ sf_simple_add_links(linkaddr_t *peer_addr, uint8_t num_links)
 int
 sf_simple_remove_links(linkaddr_t *peer_addr)
 {
-  uint8_t i = 0, index = 0;
-  struct tsch_slotframe *sf =
-    tsch_schedule_get_slotframe_by_handle(slotframe_handle);
+  uint8_t index = 0;
+  struct tsch_slotframe *sf = get_slotframe(data_slotframe_handle(peer_addr));
   struct tsch_link *l;
 
   uint16_t req_len;
   sf_simple_cell_t cell;
+  sf_simple_trans_buf_t *buf;
 
   assert(peer_addr != NULL && sf != NULL);
 
-  for(i = 0; i < TSCH_SCHEDULE_DEFAULT_LENGTH; i++) {
-    l = tsch_schedule_get_link_by_offsets(sf, i, 0);
-
-    if(l) {
-      /* Non-zero value indicates a scheduled link */
-      if((linkaddr_cmp(&l->addr, peer_addr)) && (l->link_options == LINK_OPTION_TX)) {
-        /* This link is scheduled as a TX link to the specified neighbor */
-        cell.timeslot_offset = i;
-        cell.channel_offset = l->channel_offset;
-        index++;
-        break;   /* delete atmost one */
-      }
+  if(sixp_trans_find(peer_addr) != NULL) {
+    return -1;
+  }
+
+  for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+    if((linkaddr_cmp(&l->addr, peer_addr)) && (l->link_options == LINK_OPTION_TX) &&
+       (index == 0 ||
+        cell_outstanding(sf->handle, l->timeslot) <
+        cell_outstanding(sf->handle, cell.timeslot_offset))) {
+      /* This link is scheduled as a TX link to the specified neighbor; delete
+       * atmost one, the one with the fewest frames waiting for it */
+      cell.timeslot_offset = l->timeslot;
+      cell.channel_offset = l->channel_offset;
+      index = 1;
     }
   }
 
@@ -593,27 +1665,47 @@ sf_simple_remove_links(linkaddr_t *peer_addr)
     return -1;
   }
 
-  memset(req_storage, 0, sizeof(req_storage));
-  if(sixp_pkt_set_num_cells(SIXP_PKT_TYPE_REQUEST,
+  if((buf = trans_buf_alloc(peer_addr)) == NULL) {
+    PRINTF("sf-simple: No transaction buffer left\r\r\n");
+    return -1;
+  }
+
+  buf->slotframe_handle = sf->handle;
+  if(set_request_slotframe(SIXP_PKT_CMD_DELETE, sf->handle,
+                           buf->body, sizeof(buf->body)) != 0 ||
+     sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                               SIXP_PKT_CELL_OPTION_TX,
+                               buf->body,
+                               sizeof(buf->body)) != 0 ||
+     sixp_pkt_set_num_cells(SIXP_PKT_TYPE_REQUEST,
                             (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
                             1,
-                            req_storage,
-                            sizeof(req_storage)) != 0 ||
+                            buf->body,
+                            sizeof(buf->body)) != 0 ||
      sixp_pkt_set_cell_list(SIXP_PKT_TYPE_REQUEST,
                             (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
                             (const uint8_t *)&cell, sizeof(cell),
                             0,
-                            req_storage, sizeof(req_storage)) != 0) {
-    PRINTF("sf-simple: Build error on add request\r\r\n");
+                            buf->body, sizeof(buf->body)) != 0) {
+    PRINTF("sf-simple: Build error on delete request\r\r\n");
+    trans_buf_free(buf);
     return -1;
   }
   /* The length of fixed part is 4 bytes: Metadata, CellOptions, and NumCells */
   req_len = 4 + sizeof(sf_simple_cell_t);
+  buf->body_len = req_len;
+
+  if(sixp_output(SIXP_PKT_TYPE_REQUEST,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                 SF_SIMPLE_SFID,
+                 buf->body, buf->body_len, peer_addr,
+                 NULL, NULL, 0) < 0) {
+    trans_buf_free(buf);
+    return -1;
+  }
 
-  sixp_output(SIXP_PKT_TYPE_REQUEST, (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
-              SF_SIMPLE_SFID,
-              req_storage, req_len, peer_addr,
-              NULL, NULL, 0);
+  request_started(peer_addr, SIXP_PKT_CMD_DELETE, 1);
 
   PRINTF("sf-simple: Send a 6P Delete Request for %d links to node ",
          1);
@@ -625,11 +1717,1318 @@ sf_simple_remove_links(linkaddr_t *peer_addr)
   return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+static void
+count_res_input(sf_simple_request_t *req,
+                const uint8_t *body, uint16_t body_len,
+                const linkaddr_t *peer_addr)
+{
+  sixp_pkt_total_num_cells_t total;
+  uint8_t num_cells;
+
+  if(sixp_pkt_get_total_num_cells(SIXP_PKT_TYPE_RESPONSE,
+                                  (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                                  &total,
+                                  body, body_len) != 0) {
+    PRINTF("sf-simple: Parse error on count response\r\r\n");
+    request_done(peer_addr);
+    return;
+  }
+
+  num_cells = count_tx_cells(peer_addr);
+  PRINTF("sf-simple: Received a 6P Count Response: %u links, %u here\r\r\n",
+         total, num_cells);
+
+  if(total == num_cells || req == NULL) {
+    request_done(peer_addr);
+    return;
+  }
+
+  /* the schedules drifted apart: walk the peer's list page by page */
+  memset(sync_confirmed, 0, sizeof(sync_confirmed));
+  sync_mismatch = 0;
+  req->offset = 0;
+  request_defer(peer_addr, SIXP_PKT_CMD_LIST);
+}
+
+static void
+list_res_input(sf_simple_request_t *req, sixp_pkt_rc_t rc,
+               const uint8_t *body, uint16_t body_len,
+               const linkaddr_t *peer_addr)
+{
+  const uint8_t *cell_list;
+  uint16_t cell_list_len;
+  struct tsch_slotframe *slotframe;
+  struct tsch_link *l;
+  struct tsch_link *next;
+  sf_simple_cell_t cell;
+  uint16_t i;
+
+  slotframe = get_slotframe(data_slotframe_handle(peer_addr));
+  if(slotframe == NULL || req == NULL ||
+     sixp_pkt_get_cell_list(SIXP_PKT_TYPE_RESPONSE,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                            &cell_list, &cell_list_len,
+                            body, body_len) != 0) {
+    PRINTF("sf-simple: Parse error on list response\r\r\n");
+    request_done(peer_addr);
+    return;
+  }
+
+  PRINTF("sf-simple: Received a 6P List Response from offset %u with "
+         "LinkList : ", req->offset);
+  print_cell_list(cell_list, cell_list_len);
+  PRINTF("\r\r\n");
+
+  /* the peer's RX cells are our TX cells; adopt those we miss if we can */
+  for(i = 0; i < cell_list_len; i += sizeof(cell)) {
+    read_cell(&cell_list[i], &cell);
+    l = tsch_schedule_get_link_by_offsets(slotframe, cell.timeslot_offset,
+                                          cell.channel_offset);
+    if(l != NULL && l->link_options == LINK_OPTION_TX &&
+       linkaddr_cmp(&l->addr, peer_addr)) {
+      sync_confirmed[cell.timeslot_offset / 32] |=
+        1UL << (cell.timeslot_offset % 32);
+    } else if(cell.timeslot_offset < slotframe->size.val &&
+              !timeslot_in_use(slotframe, cell.timeslot_offset)) {
+      add_links_to_schedule(slotframe, peer_addr, LINK_OPTION_TX,
+                            &cell_list[i], sizeof(cell));
+      sync_confirmed[cell.timeslot_offset / 32] |=
+        1UL << (cell.timeslot_offset % 32);
+    } else {
+      sync_mismatch = 1;
+    }
+  }
+  req->offset += cell_list_len / sizeof(cell);
+
+  if(rc == SIXP_PKT_RC_SUCCESS && cell_list_len > 0) {
+    /* more to come */
+    request_defer(peer_addr, SIXP_PKT_CMD_LIST);
+    return;
+  }
+
+  /* end of list: our TX cells the peer does not have are of no use */
+  for(l = list_head(slotframe->links_list); l != NULL; l = next) {
+    next = list_item_next(l);
+    if(l->link_options == LINK_OPTION_TX &&
+       linkaddr_cmp(&l->addr, peer_addr) &&
+       l->timeslot < SF_SIMPLE_MAX_TIMESLOTS &&
+       !(sync_confirmed[l->timeslot / 32] & (1UL << (l->timeslot % 32)))) {
+      cell.timeslot_offset = l->timeslot;
+      cell.channel_offset = l->channel_offset;
+      remove_links_to_schedule(slotframe, peer_addr, LINK_OPTION_TX,
+                               (const uint8_t *)&cell, sizeof(cell));
+    }
+  }
+
+  if(sync_mismatch) {
+    /* cells of the peer clash with our schedule: start over from scratch */
+    PRINTF("sf-simple: Schedules cannot be reconciled, clearing\r\r\n");
+    request_defer(peer_addr, SIXP_PKT_CMD_CLEAR);
+  } else {
+    PRINTF("sf-simple: Schedule in sync with node ");
+    PRINTLLADDR((uip_lladdr_t *)peer_addr);
+    PRINTF("\r\r\n");
+    request_done(peer_addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Initiates a Sixtop schedule consistency check: COUNT our TX cells at the
+ * peer, then LIST them if the counts differ
+ */
+int
+sf_simple_sync_links(linkaddr_t *peer_addr)
+{
+  uint8_t req_body[sizeof(sixp_pkt_metadata_t) +
+                   sizeof(sixp_pkt_cell_options_t)];
+  int i;
+
+  assert(peer_addr != NULL);
+
+  if(sixp_trans_find(peer_addr) != NULL) {
+    return -1;
+  }
+
+  /* the LIST pages of one check at a time are tracked */
+  for(i = 0; i < SF_SIMPLE_MAX_TRANSACTIONS; i++) {
+    if(requests[i].in_use &&
+       (requests[i].cmd == SIXP_PKT_CMD_COUNT ||
+        requests[i].cmd == SIXP_PKT_CMD_LIST) &&
+       !linkaddr_cmp(&requests[i].peer_addr, peer_addr)) {
+      return -1;
+    }
+  }
+
+  memset(req_body, 0, sizeof(req_body));
+  if(set_request_slotframe(SIXP_PKT_CMD_COUNT,
+                           data_slotframe_handle(peer_addr),
+                           req_body, sizeof(req_body)) != 0 ||
+     sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_COUNT,
+                               SIXP_PKT_CELL_OPTION_TX,
+                               req_body, sizeof(req_body)) != 0) {
+    PRINTF("sf-simple: Build error on count request\r\r\n");
+    return -1;
+  }
+
+  if(sixp_output(SIXP_PKT_TYPE_REQUEST,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_COUNT,
+                 SF_SIMPLE_SFID,
+                 req_body, sizeof(req_body), peer_addr,
+                 NULL, NULL, 0) < 0) {
+    return -1;
+  }
+
+  request_started(peer_addr, SIXP_PKT_CMD_COUNT, 0);
+
+  PRINTF("sf-simple: Send a 6P Count Request to node ");
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF("\r\r\n");
+
+  return 0;
+}
+
+static int
+send_list_request(const linkaddr_t *peer_addr, uint16_t offset)
+{
+  /* Metadata, CellOptions, Reserved, Offset and MaxNumCells */
+  uint8_t req_body[sizeof(sixp_pkt_metadata_t) +
+                   sizeof(sixp_pkt_cell_options_t) +
+                   sizeof(sixp_pkt_reserved_t) +
+                   sizeof(sixp_pkt_offset_t) +
+                   sizeof(sixp_pkt_max_num_cells_t)];
+
+  if(sixp_trans_find(peer_addr) != NULL) {
+    return -1;
+  }
+
+  memset(req_body, 0, sizeof(req_body));
+  if(set_request_slotframe(SIXP_PKT_CMD_LIST,
+                           data_slotframe_handle(peer_addr),
+                           req_body, sizeof(req_body)) != 0 ||
+     sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_LIST,
+                               SIXP_PKT_CELL_OPTION_TX,
+                               req_body, sizeof(req_body)) != 0 ||
+     sixp_pkt_set_offset(SIXP_PKT_TYPE_REQUEST,
+                         (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_LIST,
+                         offset,
+                         req_body, sizeof(req_body)) != 0 ||
+     sixp_pkt_set_max_num_cells(SIXP_PKT_TYPE_REQUEST,
+                                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_LIST,
+                                SF_SIMPLE_MAX_LINKS,
+                                req_body, sizeof(req_body)) != 0) {
+    PRINTF("sf-simple: Build error on list request\r\r\n");
+    return -1;
+  }
+
+  if(sixp_output(SIXP_PKT_TYPE_REQUEST,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_LIST,
+                 SF_SIMPLE_SFID,
+                 req_body, sizeof(req_body), peer_addr,
+                 NULL, NULL, 0) < 0) {
+    return -1;
+  }
+
+  request_started(peer_addr, SIXP_PKT_CMD_LIST, 0);
+
+  PRINTF("sf-simple: Send a 6P List Request from offset %u to node ", offset);
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF("\r\r\n");
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Initiates a Sixtop schedule wipe: every cell shared with the peer goes,
+ * on our side as soon as the request is out
+ */
+int
+sf_simple_clear_links(linkaddr_t *peer_addr)
+{
+  uint8_t req_body[sizeof(sixp_pkt_metadata_t)];
+
+  assert(peer_addr != NULL);
+
+  if(sixp_trans_find(peer_addr) != NULL) {
+    return -1;
+  }
+
+  /* CLEAR wipes both data slotframes; the Metadata names the usual one */
+  memset(req_body, 0, sizeof(req_body));
+  if(set_request_slotframe(SIXP_PKT_CMD_CLEAR,
+                           data_slotframe_handle(peer_addr),
+                           req_body, sizeof(req_body)) != 0 ||
+     sixp_output(SIXP_PKT_TYPE_REQUEST,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_CLEAR,
+                 SF_SIMPLE_SFID,
+                 req_body, sizeof(req_body), peer_addr,
+                 NULL, NULL, 0) < 0) {
+    return -1;
+  }
+
+  remove_all_links_with(peer_addr);
+  request_started(peer_addr, SIXP_PKT_CMD_CLEAR, 0);
+
+  PRINTF("sf-simple: Send a 6P Clear Request to node ");
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF("\r\r\n");
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Prints the negotiated cells, one line each: slotframe/timeslot/channel
+ * offset, direction, last two bytes of the neighbour address, then for a
+ * TX cell the frames sent, acknowledged and failed over it since it was
+ * installed, and the occurrences of the cell that carried none of them.
+ * A retransmission takes another occurrence, so idle overstates the
+ * slack of a cell that sees failures. Cells without statistics print
+ * none. Then, per slotframe and neighbour, the unicast frames received
+ * from it since the first one; see sf_simple_rx_stats_t. */
+void
+sf_simple_print_cells(void)
+{
+  static const uint16_t handles[] = {
+    SF_SIMPLE_UPLINK_SF_HANDLE, SF_SIMPLE_DOWNLINK_SF_HANDLE
+  };
+  struct tsch_slotframe *slotframe;
+  struct tsch_link *l;
+#if SF_SIMPLE_CELL_STATS
+  sf_simple_cell_stats_t *stats;
+  sf_simple_rx_stats_t *rx;
+  uint32_t occurrences;
+  int j;
+#endif /* SF_SIMPLE_CELL_STATS */
+  int i;
+
+  printf("sf-simple cells at ASN %lu:\r\n",
+         (unsigned long)tsch_current_asn.ls4b);
+  for(i = 0; i < (int)(sizeof(handles) / sizeof(handles[0])); i++) {
+    slotframe = tsch_schedule_get_slotframe_by_handle(handles[i]);
+    if(slotframe == NULL) {
+      continue;
+    }
+
+    for(l = list_head(slotframe->links_list); l != NULL;
+        l = list_item_next(l)) {
+      printf("%u/%u/%u %s %02x%02x", slotframe->handle, l->timeslot,
+             l->channel_offset,
+             (l->link_options & LINK_OPTION_TX) ? "TX" : "RX",
+             l->addr.u8[LINKADDR_SIZE - 2], l->addr.u8[LINKADDR_SIZE - 1]);
+#if SF_SIMPLE_CELL_STATS
+      stats = cell_stats_find(slotframe->handle, l->timeslot);
+      if(stats != NULL) {
+        occurrences = cell_occurrences(stats);
+        printf(" tx %u ack %u nack %u idle %lu",
+               stats->sent, stats->acked, stats->failed,
+               (unsigned long)(occurrences > stats->sent ?
+                               occurrences - stats->sent : 0));
+      }
+#endif /* SF_SIMPLE_CELL_STATS */
+      printf("\r\n");
+    }
+#if SF_SIMPLE_CELL_STATS
+    for(j = 0; j < SF_SIMPLE_MAX_PEERS; j++) {
+      rx = &rx_stats[j];
+      if(rx->in_use && rx->slotframe_handle == slotframe->handle) {
+        printf("%u RX %02x%02x rx %u since %lu\r\n", slotframe->handle,
+               rx->peer_addr.u8[LINKADDR_SIZE - 2],
+               rx->peer_addr.u8[LINKADDR_SIZE - 1], rx->received,
+               (unsigned long)rx->since_asn);
+      }
+    }
+#endif /* SF_SIMPLE_CELL_STATS */
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Pins unicast frames to one of the dedicated TX cells of their neighbour,
+ * the one with the fewest frames already waiting for it, so that the outcome
+ * of the frame can be accounted to that cell. 6P frames stay in the control
+ * slotframe; other frames, and those SF_SIMPLE_CALLBACK_PIN_PACKET declines
+ * to pin, can go over any cell. */
+int
+sf_simple_callback_packet_ready(void)
+{
+  uint16_t slotframe = 0xffff;
+  uint16_t timeslot = 0xffff;
+#if SF_SIMPLE_CELL_STATS
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  sf_simple_cell_stats_t *best = NULL;
+  int i;
+
+  /* 6P frames, carried in IEs, are not reported to the sniffer */
+  if(!linkaddr_cmp(dest, &linkaddr_null) &&
+     !packetbuf_attr(PACKETBUF_ATTR_MAC_METADATA)
+#ifdef SF_SIMPLE_CALLBACK_PIN_PACKET
+     && SF_SIMPLE_CALLBACK_PIN_PACKET()
+#endif
+     ) {
+    for(i = 0; i < SF_SIMPLE_MAX_CELL_STATS; i++) {
+      if(cell_stats[i].in_use && !cell_stats[i].relocating &&
+         linkaddr_cmp(&cell_stats[i].peer_addr, dest) &&
+         (best == NULL || cell_stats[i].outstanding < best->outstanding)) {
+        best = &cell_stats[i];
+      }
+    }
+    if(best != NULL && best->outstanding < 0xff) {
+      best->outstanding++;
+      slotframe = best->slotframe_handle;
+      timeslot = best->timeslot_offset;
+    }
+  }
+#endif /* SF_SIMPLE_CELL_STATS */
+  if(packetbuf_attr(PACKETBUF_ATTR_MAC_METADATA)) {
+    /* 6P keeps to the shared cells of the control slotframe */
+    slotframe = SF_SIMPLE_CONTROL_SF_HANDLE;
+  }
+
+  packetbuf_set_attr(PACKETBUF_ATTR_TSCH_SLOTFRAME, slotframe);
+  packetbuf_set_attr(PACKETBUF_ATTR_TSCH_TIMESLOT, timeslot);
+  packetbuf_set_attr(PACKETBUF_ATTR_TSCH_CHANNEL_OFFSET, 0xffff);
+  return 1;
+}
+
+#if SF_SIMPLE_AUTONOMOUS
+/* Receiver-based autonomous cell of a node: any neighbour can compute it
+ * from the address alone, no signalling needed */
+static uint16_t
+autonomous_timeslot(const linkaddr_t *addr)
+{
+  uint16_t hash = 0;
+  int i;
+
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = hash * 31 + addr->u8[i];
+  }
+  return hash % SF_SIMPLE_AUTONOMOUS_SF_LENGTH;
+}
+
+/* Keep our RX autonomous cell installed, and a TX one to the receiver cell
+ * of the parent as long as no negotiated cell to it exists */
+static void
+autonomous_update(void)
+{
+  struct tsch_slotframe *slotframe;
+  struct tsch_neighbor *time_source;
+  const linkaddr_t *tx_addr = &linkaddr_null;
+  uint16_t rx_timeslot;
+  uint16_t tx_timeslot;
+
+  if(!tsch_is_associated ||
+     (slotframe = get_slotframe(SF_SIMPLE_AUTONOMOUS_SF_HANDLE)) == NULL) {
+    return;
+  }
+
+  time_source = tsch_queue_get_time_source();
+  if(time_source != NULL && count_tx_cells(&time_source->addr) == 0) {
+    tx_addr = &time_source->addr;
+  }
+
+  rx_timeslot = autonomous_timeslot(&linkaddr_node_addr);
+  if(!linkaddr_cmp(tx_addr, &autonomous_tx_addr)) {
+    if(!linkaddr_cmp(&autonomous_tx_addr, &linkaddr_null)) {
+      tsch_schedule_remove_link_by_offsets(slotframe,
+                                           autonomous_timeslot(&autonomous_tx_addr),
+                                           SF_SIMPLE_AUTONOMOUS_CHANNEL_OFFSET);
+      PRINTF("sf-simple: Autonomous TX cell to node ");
+      PRINTLLADDR((uip_lladdr_t *)&autonomous_tx_addr);
+      PRINTF(" removed\r\r\n");
+    }
+    linkaddr_copy(&autonomous_tx_addr, tx_addr);
+    if(!linkaddr_cmp(tx_addr, &linkaddr_null)) {
+      /* shared with the other children of the parent: CSMA back-off */
+      tx_timeslot = autonomous_timeslot(tx_addr);
+      tsch_schedule_add_link(slotframe,
+                             LINK_OPTION_TX | LINK_OPTION_SHARED |
+                             (tx_timeslot == rx_timeslot ? LINK_OPTION_RX : 0),
+                             LINK_TYPE_NORMAL, tx_addr,
+                             tx_timeslot, SF_SIMPLE_AUTONOMOUS_CHANNEL_OFFSET,
+                             1);
+      PRINTF("sf-simple: Autonomous TX cell %u to node ", tx_timeslot);
+      PRINTLLADDR((uip_lladdr_t *)tx_addr);
+      PRINTF("\r\r\n");
+    }
+  }
+
+  /* also brings the RX cell back when the TX cell sharing it went away */
+  if(tsch_schedule_get_link_by_offsets(slotframe, rx_timeslot,
+                                       SF_SIMPLE_AUTONOMOUS_CHANNEL_OFFSET) == NULL) {
+    tsch_schedule_add_link(slotframe, LINK_OPTION_RX | LINK_OPTION_SHARED,
+                           LINK_TYPE_NORMAL, &tsch_broadcast_address,
+                           rx_timeslot, SF_SIMPLE_AUTONOMOUS_CHANNEL_OFFSET,
+                           1);
+    PRINTF("sf-simple: Autonomous RX cell %u\r\r\n", rx_timeslot);
+  }
+}
+#endif /* SF_SIMPLE_AUTONOMOUS */
+
+/* Called by TSCH when RPL switches to another parent */
+void
+sf_simple_callback_new_time_source(const struct tsch_neighbor *old,
+                                   const struct tsch_neighbor *new)
+{
+#if SF_SIMPLE_AUTONOMOUS
+  autonomous_update();
+#endif /* SF_SIMPLE_AUTONOMOUS */
+}
+
+/* Frames pinned to a cell and not sent yet */
+static uint8_t
+cell_outstanding(uint16_t handle, uint16_t timeslot)
+{
+#if SF_SIMPLE_CELL_STATS
+  sf_simple_cell_stats_t *stats = cell_stats_find(handle, timeslot);
+
+  if(stats != NULL) {
+    return stats->outstanding;
+  }
+#endif /* SF_SIMPLE_CELL_STATS */
+  return 0;
+}
+
+#if SF_SIMPLE_CELL_STATS
+static sf_simple_cell_stats_t *
+cell_stats_find(uint16_t handle, uint16_t timeslot)
+{
+  int i;
+
+  for(i = 0; i < SF_SIMPLE_MAX_CELL_STATS; i++) {
+    if(cell_stats[i].in_use && cell_stats[i].slotframe_handle == handle &&
+       cell_stats[i].timeslot_offset == timeslot) {
+      return &cell_stats[i];
+    }
+  }
+  return NULL;
+}
+
+static void
+cell_stats_add(const linkaddr_t *peer_addr, uint16_t handle,
+               uint16_t timeslot)
+{
+  sf_simple_cell_stats_t *stats;
+  int i;
+
+  if((stats = cell_stats_find(handle, timeslot)) == NULL) {
+    for(i = 0; i < SF_SIMPLE_MAX_CELL_STATS; i++) {
+      if(!cell_stats[i].in_use) {
+        stats = &cell_stats[i];
+        break;
+      }
+    }
+    if(stats == NULL) {
+      /* the cell is still used, only neither pinned to nor relocated */
+      return;
+    }
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  linkaddr_copy(&stats->peer_addr, peer_addr);
+  stats->slotframe_handle = handle;
+  stats->timeslot_offset = timeslot;
+  stats->in_use = 1;
+  stats->since_asn = tsch_current_asn.ls4b;
+}
+
+static void
+count(uint16_t *counter)
+{
+  if(*counter < 0xffff) {
+    (*counter)++;
+  }
+}
+
+/* Times the cell came up since it was installed */
+static uint32_t
+cell_occurrences(const sf_simple_cell_stats_t *stats)
+{
+  struct tsch_slotframe *slotframe =
+    tsch_schedule_get_slotframe_by_handle(stats->slotframe_handle);
+
+  if(slotframe == NULL || slotframe->size.val == 0) {
+    return 0;
+  }
+  return (uint32_t)(tsch_current_asn.ls4b - stats->since_asn) /
+         slotframe->size.val;
+}
+
+static void
+cell_stats_remove(uint16_t handle, uint16_t timeslot)
+{
+  sf_simple_cell_stats_t *stats = cell_stats_find(handle, timeslot);
+  int i;
+
+  if(stats == NULL) {
+    return;
+  }
+
+  stats->in_use = 0;
+  if(stats->outstanding > 0) {
+    /* frames pinned to the cell would wait for it forever */
+    PRINTF("sf-simple: Flushing %u frames pinned to cell %u/%u\r\r\n",
+           stats->outstanding, timeslot, handle);
+    tsch_queue_free_packets_to(&stats->peer_addr);
+    for(i = 0; i < SF_SIMPLE_MAX_CELL_STATS; i++) {
+      if(linkaddr_cmp(&cell_stats[i].peer_addr, &stats->peer_addr)) {
+        cell_stats[i].outstanding = 0;
+      }
+    }
+  }
+}
+
+static void
+cell_stats_relocation_done(const linkaddr_t *peer_addr)
+{
+  int i;
+
+  for(i = 0; i < SF_SIMPLE_MAX_CELL_STATS; i++) {
+    if(cell_stats[i].in_use &&
+       linkaddr_cmp(&cell_stats[i].peer_addr, peer_addr)) {
+      cell_stats[i].relocating = 0;
+    }
+  }
+}
+
+/* Ask the peer to move one of our TX cells to one of a few fresh
+ * candidates */
+static int
+relocate_cell(sf_simple_cell_stats_t *stats)
+{
+  struct tsch_slotframe *sf =
+    tsch_schedule_get_slotframe_by_handle(stats->slotframe_handle);
+  struct tsch_link *l;
+  sf_simple_cell_t cell;
+  sf_simple_cell_t cand_list[SF_SIMPLE_MAX_LINKS];
+  uint8_t num_cand;
+  sf_simple_trans_buf_t *buf;
+
+  if(sf == NULL || sixp_trans_find(&stats->peer_addr) != NULL) {
+    return -1;
+  }
+
+  for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+    if(l->timeslot == stats->timeslot_offset &&
+       linkaddr_cmp(&l->addr, &stats->peer_addr)) {
+      break;
+    }
+  }
+  if(l == NULL) {
+    return -1;
+  }
+  cell.timeslot_offset = l->timeslot;
+  cell.channel_offset = l->channel_offset;
+
+  /* the relocation list takes one cell of the body */
+  if((num_cand = draw_candidate_cells(sf, cand_list,
+                                      SF_SIMPLE_MAX_LINKS - 1)) == 0) {
+    PRINTF("sf-simple:! No free slot left\r\r\n");
+    return -1;
+  }
+
+  if((buf = trans_buf_alloc(&stats->peer_addr)) == NULL) {
+    PRINTF("sf-simple: No transaction buffer left\r\r\n");
+    return -1;
+  }
+
+  buf->slotframe_handle = sf->handle;
+  if(set_request_slotframe(SIXP_PKT_CMD_RELOCATE, sf->handle,
+                           buf->body, sizeof(buf->body)) != 0 ||
+     sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                               SIXP_PKT_CELL_OPTION_TX,
+                               buf->body,
+                               sizeof(buf->body)) != 0 ||
+     sixp_pkt_set_num_cells(SIXP_PKT_TYPE_REQUEST,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                            1,
+                            buf->body,
+                            sizeof(buf->body)) != 0 ||
+     sixp_pkt_set_rel_cell_list(SIXP_PKT_TYPE_REQUEST,
+                                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                                (const uint8_t *)&cell, sizeof(cell), 0,
+                                buf->body, sizeof(buf->body)) != 0 ||
+     sixp_pkt_set_cand_cell_list(SIXP_PKT_TYPE_REQUEST,
+                                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                                 (const uint8_t *)cand_list,
+                                 num_cand * sizeof(sf_simple_cell_t), 0,
+                                 buf->body, sizeof(buf->body)) != 0) {
+    PRINTF("sf-simple: Build error on relocate request\r\r\n");
+    trans_buf_free(buf);
+    return -1;
+  }
+
+  /* fixed part, then the relocation and candidate cell lists */
+  buf->body_len = 4 + (1 + num_cand) * sizeof(sf_simple_cell_t);
+  if(sixp_output(SIXP_PKT_TYPE_REQUEST,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                 SF_SIMPLE_SFID,
+                 buf->body, buf->body_len, &stats->peer_addr,
+                 NULL, NULL, 0) < 0) {
+    trans_buf_free(buf);
+    return -1;
+  }
+
+  PRINTF("sf-simple: Send a 6P Relocate Request for link (%u,%u) "
+         "(%u/%u frames acked) to node ",
+         cell.timeslot_offset, cell.channel_offset,
+         stats->tx_ack, stats->tx);
+  PRINTLLADDR((uip_lladdr_t *)&stats->peer_addr);
+  PRINTF(" with CandidateList : ");
+  print_cell_list((const uint8_t *)cand_list,
+                  num_cand * sizeof(sf_simple_cell_t));
+  PRINTF("\r\r\n");
+
+  /* should the relocation fail, the cell is judged again on new frames */
+  stats->relocating = 1;
+  stats->tx = 0;
+  stats->tx_ack = 0;
+  return 0;
+}
+
+/* Look for the worst cell of every bundle and relocate it if its delivery
+ * ratio is far below the one of the bundle, or plainly bad */
+static void
+relocate_check(void)
+{
+  sf_simple_cell_stats_t *stats;
+  sf_simple_cell_stats_t *worst;
+  uint32_t bundle_tx;
+  uint32_t bundle_ack;
+  int i;
+  int j;
+
+  for(i = 0; i < SF_SIMPLE_MAX_CELL_STATS; i++) {
+    stats = &cell_stats[i];
+    if(!stats->in_use) {
+      continue;
+    }
+
+    /* a bundle is handled from its first entry */
+    for(j = 0; j < i; j++) {
+      if(cell_stats[j].in_use &&
+         linkaddr_cmp(&cell_stats[j].peer_addr, &stats->peer_addr)) {
+        break;
+      }
+    }
+    if(j < i ||
+       sixp_trans_find(&stats->peer_addr) != NULL ||
+       request_find(&stats->peer_addr) != NULL) {
+      continue;
+    }
+
+    bundle_tx = 0;
+    bundle_ack = 0;
+    worst = NULL;
+    for(j = i; j < SF_SIMPLE_MAX_CELL_STATS; j++) {
+      if(!cell_stats[j].in_use ||
+         !linkaddr_cmp(&cell_stats[j].peer_addr, &stats->peer_addr)) {
+        continue;
+      }
+      bundle_tx += cell_stats[j].tx;
+      bundle_ack += cell_stats[j].tx_ack;
+      if(cell_stats[j].tx >= SF_SIMPLE_RELOCATE_MIN_TX &&
+         (worst == NULL ||
+          (uint32_t)cell_stats[j].tx_ack * worst->tx <
+          (uint32_t)worst->tx_ack * cell_stats[j].tx)) {
+        worst = &cell_stats[j];
+      }
+    }
+
+    if(worst != NULL &&
+       ((uint32_t)worst->tx_ack * bundle_tx * 100 <
+        bundle_ack * worst->tx * SF_SIMPLE_RELOCATE_PDR_RATIO ||
+        (uint32_t)worst->tx_ack * 100 <
+        (uint32_t)worst->tx * SF_SIMPLE_RELOCATE_MIN_PDR)) {
+      relocate_cell(worst);
+    }
+  }
+}
+#endif /* SF_SIMPLE_CELL_STATS */
+
+static uint8_t
+count_tx_cells(const linkaddr_t *peer_addr)
+{
+  return count_links_with(get_slotframe(data_slotframe_handle(peer_addr)),
+                          peer_addr, LINK_OPTION_TX);
+}
+
+#if SF_SIMPLE_ADAPTIVE || SF_SIMPLE_CELL_STATS
+#if SF_SIMPLE_CELL_STATS
+NETSTACK_SNIFFER(sf_simple_sniffer, sniffer_input, sniffer_output);
+#else
+NETSTACK_SNIFFER(sf_simple_sniffer, NULL, sniffer_output);
+#endif /* SF_SIMPLE_CELL_STATS */
+
+/* Called for every frame the MAC is done with. Counts the unicast frames
+ * sent to each tracked neighbour, i.e. how much of its cells we really use,
+ * and the outcome of the frames pinned to a cell. */
+static void
+sniffer_output(int mac_status)
+{
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+#if SF_SIMPLE_ADAPTIVE
+  sf_simple_peer_t *peer;
+#endif /* SF_SIMPLE_ADAPTIVE */
+#if SF_SIMPLE_CELL_STATS
+  sf_simple_cell_stats_t *stats;
+#endif /* SF_SIMPLE_CELL_STATS */
+
+  if(linkaddr_cmp(dest, &linkaddr_null)) {
+    return;
+  }
+
+#if SF_SIMPLE_ADAPTIVE
+  if((peer = find_peer(dest, 1)) != NULL && peer->tx_frames < 0xffff) {
+    peer->tx_frames++;
+  }
+#endif /* SF_SIMPLE_ADAPTIVE */
+
+#if SF_SIMPLE_CELL_STATS
+  if((stats = cell_stats_find(packetbuf_attr(PACKETBUF_ATTR_TSCH_SLOTFRAME),
+                              packetbuf_attr(PACKETBUF_ATTR_TSCH_TIMESLOT))) != NULL &&
+     linkaddr_cmp(&stats->peer_addr, dest)) {
+    if(stats->outstanding > 0) {
+      stats->outstanding--;
+    }
+    /* frames which never made it to the air say nothing about the cell */
+    if(mac_status == MAC_TX_OK || mac_status == MAC_TX_NOACK ||
+       mac_status == MAC_TX_COLLISION) {
+      stats->tx++;
+      count(&stats->sent);
+      if(mac_status == MAC_TX_OK) {
+        stats->tx_ack++;
+        count(&stats->acked);
+      } else {
+        count(&stats->failed);
+      }
+      if(stats->tx >= SF_SIMPLE_CELL_STATS_WINDOW) {
+        stats->tx /= 2;
+        stats->tx_ack /= 2;
+      }
+    }
+  }
+#endif /* SF_SIMPLE_CELL_STATS */
+}
+#endif /* SF_SIMPLE_ADAPTIVE || SF_SIMPLE_CELL_STATS */
+
+#if SF_SIMPLE_CELL_STATS
+/* Data slotframe of our RX cells from a neighbour. Without any, the one
+ * they would be negotiated in: the time source adds them in its downlink
+ * slotframe, a child in its uplink one, and the handles are the same on
+ * both ends. */
+static uint16_t
+rx_slotframe_handle(const linkaddr_t *peer_addr)
+{
+  static const uint16_t handles[] = {
+    SF_SIMPLE_UPLINK_SF_HANDLE, SF_SIMPLE_DOWNLINK_SF_HANDLE
+  };
+  int i;
+
+  for(i = 0; i < (int)(sizeof(handles) / sizeof(handles[0])); i++) {
+    if(count_links_with(tsch_schedule_get_slotframe_by_handle(handles[i]),
+                        peer_addr, LINK_OPTION_RX) > 0) {
+      return handles[i];
+    }
+  }
+  return data_slotframe_handle(peer_addr) == SF_SIMPLE_UPLINK_SF_HANDLE ?
+         SF_SIMPLE_DOWNLINK_SF_HANDLE : SF_SIMPLE_UPLINK_SF_HANDLE;
+}
+
+uint16_t
+sf_simple_rx_frames(const linkaddr_t *peer_addr, uint16_t handle)
+{
+  int i;
+
+  for(i = 0; i < SF_SIMPLE_MAX_PEERS; i++) {
+    if(rx_stats[i].in_use && rx_stats[i].slotframe_handle == handle &&
+       linkaddr_cmp(&rx_stats[i].peer_addr, peer_addr)) {
+      return rx_stats[i].received;
+    }
+  }
+  return 0;
+}
+
+/* Called for every frame received: counts the unicast ones per
+ * neighbour, see sf_simple_rx_stats_t */
+static void
+sniffer_input(void)
+{
+  const linkaddr_t *src = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  uint16_t handle;
+  sf_simple_rx_stats_t *rx = NULL;
+  int i;
+
+  if(!linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                   &linkaddr_node_addr)) {
+    /* broadcast, over the shared cells */
+    return;
+  }
+
+  handle = rx_slotframe_handle(src);
+  for(i = 0; i < SF_SIMPLE_MAX_PEERS; i++) {
+    if(rx_stats[i].in_use && rx_stats[i].slotframe_handle == handle &&
+       linkaddr_cmp(&rx_stats[i].peer_addr, src)) {
+      rx = &rx_stats[i];
+      break;
+    }
+    if(!rx_stats[i].in_use && rx == NULL) {
+      rx = &rx_stats[i];
+    }
+  }
+  if(rx == NULL) {
+    return;
+  }
+
+  if(!rx->in_use) {
+    linkaddr_copy(&rx->peer_addr, src);
+    rx->slotframe_handle = handle;
+    rx->in_use = 1;
+    rx->since_asn = tsch_current_asn.ls4b;
+    rx->received = 0;
+  }
+  count(&rx->received);
+}
+#endif /* SF_SIMPLE_CELL_STATS */
+
+#if SF_SIMPLE_ADAPTIVE
+
+static sf_simple_peer_t *
+find_peer(const linkaddr_t *peer_addr, int alloc)
+{
+  sf_simple_peer_t *free_peer = NULL;
+  int i;
+
+  for(i = 0; i < SF_SIMPLE_MAX_PEERS; i++) {
+    if(peers[i].in_use) {
+      if(linkaddr_cmp(&peers[i].addr, peer_addr)) {
+        return &peers[i];
+      }
+    } else if(free_peer == NULL) {
+      free_peer = &peers[i];
+    }
+  }
+
+  if(alloc && free_peer != NULL) {
+    memset(free_peer, 0, sizeof(*free_peer));
+    linkaddr_copy(&free_peer->addr, peer_addr);
+    free_peer->in_use = 1;
+  }
+  return alloc ? free_peer : NULL;
+}
+
+static void
+evaluate_peer(sf_simple_peer_t *peer, int is_time_source)
+{
+  uint8_t num_cells;
+  uint32_t cell_capacity;
+  uint32_t usage;
+  uint8_t num_add;
+  uint8_t min_cells = is_time_source ? SF_SIMPLE_MIN_CELLS : 0;
+  uint16_t length = is_time_source ? SF_SIMPLE_UPLINK_SF_LENGTH :
+    SF_SIMPLE_DOWNLINK_SF_LENGTH;
+
+  if(sixp_trans_find(&peer->addr) != NULL ||
+     request_find(&peer->addr) != NULL) {
+    /* a negotiation with this neighbour is still going on; decide later */
+    return;
+  }
+
+  num_cells = count_tx_cells(&peer->addr);
+
+  /* TX opportunities a cell offers over the window: one per iteration of
+   * the slotframe it lives in. Without cells, usage is the one the first
+   * cell would see. */
+  cell_capacity = ((uint32_t)SF_SIMPLE_WINDOW * SF_SIMPLE_HOUSEKEEPING_PERIOD *
+                   (1000000UL / CLOCK_SECOND)) /
+    ((uint32_t)length * TSCH_DEFAULT_TIMESLOT_LENGTH);
+  cell_capacity = MAX(cell_capacity, 1);
+  usage = (uint32_t)peer->tx_frames * 100 /
+    (cell_capacity * MAX(num_cells, 1));
+
+  PRINTF("sf-simple: node ");
+  PRINTLLADDR((uip_lladdr_t *)&peer->addr);
+  PRINTF(" cells %u queue %u/%u usage %lu%%\r\r\n",
+         num_cells, peer->queue_sum, peer->samples, (unsigned long)usage);
+
+  /* A first cell is only worth it when it would not sit idle: a light
+   * neighbour stays on the shared cells rather than have a cell added and
+   * deleted every other window */
+  if(num_cells < SF_SIMPLE_MAX_CELLS &&
+     (num_cells < min_cells ||
+      peer->queue_sum >= SF_SIMPLE_QUEUE_THRESHOLD * peer->samples ||
+      (peer->tx_frames > 0 &&
+       usage >= (num_cells > 0 ? SF_SIMPLE_USAGE_HIGH : SF_SIMPLE_USAGE_LOW)))) {
+    /* one cell, plus one per queue threshold of average backlog */
+    num_add = 1 + peer->queue_sum /
+      (SF_SIMPLE_QUEUE_THRESHOLD * peer->samples);
+    num_add = MIN(num_add, SF_SIMPLE_MAX_CELLS - num_cells);
+    num_add = MIN(num_add, SF_SIMPLE_MAX_LINKS);
+    peer->idle_windows = 0;
+    sf_simple_add_links(&peer->addr, num_add);
+  } else if(num_cells > min_cells &&
+            peer->queue_sum == 0 && usage < SF_SIMPLE_USAGE_LOW) {
+    /* DELETE only once the cells stayed idle for a few windows in a row */
+    if(++peer->idle_windows >= SF_SIMPLE_IDLE_WINDOWS) {
+      peer->idle_windows = 0;
+      sf_simple_remove_links(&peer->addr);
+    }
+  } else if(num_cells == 0 && peer->tx_frames == 0 && !is_time_source) {
+    /* nothing scheduled and nothing sent: stop tracking this neighbour */
+    peer->in_use = 0;
+  } else {
+    peer->idle_windows = 0;
+  }
+}
+
+#endif /* SF_SIMPLE_ADAPTIVE */
+
+static void
+housekeeping(void *ptr)
+{
+  struct tsch_neighbor *time_source;
+#if SF_SIMPLE_ADAPTIVE
+  struct tsch_neighbor *n;
+  int i;
+#endif /* SF_SIMPLE_ADAPTIVE */
+
+  ctimer_reset(&housekeeping_timer);
+
+  if(!tsch_is_associated) {
+    /* TSCH drops every slotframe when it associates again, and the
+     * requests and neighbours of the former network are of no use */
+    linkaddr_copy(&last_time_source, &linkaddr_null);
+    memset(occupancy, 0, sizeof(occupancy));
+    forget_peers();
+    return;
+  }
+
+#if SF_SIMPLE_AUTONOMOUS
+  autonomous_update();
+#endif /* SF_SIMPLE_AUTONOMOUS */
+
+  time_source = tsch_queue_get_time_source();
+  if(time_source != NULL &&
+     !linkaddr_cmp(&time_source->addr, &last_time_source)) {
+    /* joined, or switched to another time source */
+    if(!linkaddr_cmp(&last_time_source, &linkaddr_null)) {
+      /* the cells to the former parent sit in the uplink slotframe */
+      remove_all_links_with(&last_time_source);
+      request_defer(&last_time_source, SIXP_PKT_CMD_CLEAR);
+    }
+    linkaddr_copy(&last_time_source, &time_source->addr);
+    since_sync = 0;
+#if SF_SIMPLE_CLEAR_ON_JOIN
+    if(sf_simple_clear_links(&time_source->addr) < 0) {
+      request_defer(&time_source->addr, SIXP_PKT_CMD_CLEAR);
+    }
+#endif /* SF_SIMPLE_CLEAR_ON_JOIN */
+  }
+
+#if SF_SIMPLE_SYNC_PERIOD
+  if(time_source != NULL &&
+     (since_sync += SF_SIMPLE_HOUSEKEEPING_PERIOD) >= SF_SIMPLE_SYNC_PERIOD &&
+     sixp_trans_find(&time_source->addr) == NULL &&
+     request_find(&time_source->addr) == NULL) {
+    since_sync = 0;
+    sf_simple_sync_links(&time_source->addr);
+  }
+#endif /* SF_SIMPLE_SYNC_PERIOD */
+
+#if SF_SIMPLE_ADAPTIVE
+  if(time_source != NULL) {
+    find_peer(&time_source->addr, 1);
+  }
+
+  for(i = 0; i < SF_SIMPLE_MAX_PEERS; i++) {
+    if(!peers[i].in_use) {
+      continue;
+    }
+    n = tsch_queue_get_nbr(&peers[i].addr);
+    if(n != NULL) {
+      peers[i].queue_sum += tsch_queue_nbr_packet_count(n);
+    }
+    if(++peers[i].samples >= SF_SIMPLE_WINDOW) {
+      evaluate_peer(&peers[i], time_source != NULL &&
+                    linkaddr_cmp(&time_source->addr, &peers[i].addr));
+      peers[i].samples = 0;
+      peers[i].queue_sum = 0;
+      peers[i].tx_frames = 0;
+    }
+  }
+#endif /* SF_SIMPLE_ADAPTIVE */
+
+#if SF_SIMPLE_CELL_STATS && SF_SIMPLE_RELOCATE
+  relocate_check();
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static sf_simple_request_t *
+request_find(const linkaddr_t *peer_addr)
+{
+  int i;
+
+  for(i = 0; i < SF_SIMPLE_MAX_TRANSACTIONS; i++) {
+    if(requests[i].in_use && linkaddr_cmp(&requests[i].peer_addr, peer_addr)) {
+      return &requests[i];
+    }
+  }
+  return NULL;
+}
+
+static sf_simple_request_t *
+request_alloc(const linkaddr_t *peer_addr)
+{
+  sf_simple_request_t *req;
+  int i;
+
+  if((req = request_find(peer_addr)) == NULL) {
+    for(i = 0; i < SF_SIMPLE_MAX_TRANSACTIONS; i++) {
+      if(!requests[i].in_use) {
+        req = &requests[i];
+        memset(req, 0, sizeof(*req));
+        linkaddr_copy(&req->peer_addr, peer_addr);
+        req->in_use = 1;
+        break;
+      }
+    }
+  }
+  return req;
+}
+
+static void
+request_started(const linkaddr_t *peer_addr, sixp_pkt_cmd_t cmd,
+                uint8_t num_links)
+{
+  sf_simple_request_t *req;
+
+  if((req = request_alloc(peer_addr)) == NULL) {
+    /* no room to track it: the request just won't be retried */
+    return;
+  }
+
+  if(req->cmd != cmd) {
+    /* a new operation; a retry keeps its attempt count */
+    req->attempts = 0;
+  }
+  ctimer_stop(&req->retry_timer);
+  req->cmd = cmd;
+  req->num_links = num_links;
+  req->pending = 1;
+}
+
+/* Send cmd to the peer shortly, out of the current transaction */
+static void
+request_defer(const linkaddr_t *peer_addr, sixp_pkt_cmd_t cmd)
+{
+  sf_simple_request_t *req;
+
+  if((req = request_alloc(peer_addr)) == NULL) {
+    return;
+  }
+
+  if(req->cmd != cmd) {
+    req->attempts = 0;
+  }
+  req->cmd = cmd;
+  req->pending = 0;
+  ctimer_set(&req->retry_timer, REQUEST_DEFER_DELAY,
+             request_retry_expired, req);
+}
+
+static void
+request_done(const linkaddr_t *peer_addr)
+{
+  sf_simple_request_t *req = request_find(peer_addr);
+
+  if(req != NULL) {
+    ctimer_stop(&req->retry_timer);
+    req->in_use = 0;
+  }
+}
+
+static void
+request_retry(sf_simple_request_t *req)
+{
+  clock_time_t delay;
+
+  req->pending = 0;
+  if(++req->attempts > SF_SIMPLE_MAX_RETRIES) {
+    PRINTF("sf-simple: Giving up 6P request %u to node ", req->cmd);
+    PRINTLLADDR((uip_lladdr_t *)&req->peer_addr);
+    PRINTF("\r\r\n");
+    request_done(&req->peer_addr);
+    return;
+  }
+
+  delay = SF_SIMPLE_RETRY_BACKOFF << (req->attempts - 1);
+  delay += random_rand() % delay;
+  PRINTF("sf-simple: Retry %u of 6P request %u in %lu ticks\r\r\n",
+         req->attempts, req->cmd, (unsigned long)delay);
+  ctimer_set(&req->retry_timer, delay, request_retry_expired, req);
+}
+
+static void
+request_retry_expired(void *ptr)
+{
+  sf_simple_request_t *req = (sf_simple_request_t *)ptr;
+  int ret;
+
+  if(!req->in_use) {
+    return;
+  }
+
+  switch(req->cmd) {
+    case SIXP_PKT_CMD_ADD:
+      ret = sf_simple_add_links(&req->peer_addr, req->num_links);
+      break;
+    case SIXP_PKT_CMD_DELETE:
+      ret = sf_simple_remove_links(&req->peer_addr);
+      break;
+    case SIXP_PKT_CMD_COUNT:
+      ret = sf_simple_sync_links(&req->peer_addr);
+      break;
+    case SIXP_PKT_CMD_LIST:
+      ret = send_list_request(&req->peer_addr, req->offset);
+      break;
+    case SIXP_PKT_CMD_CLEAR:
+      ret = sf_simple_clear_links(&req->peer_addr);
+      break;
+    default:
+      request_done(&req->peer_addr);
+      return;
+  }
+
+  if(ret < 0 && req->in_use && !req->pending) {
+    /* could not even be sent (busy peer, nothing left to delete, ...) */
+    request_retry(req);
+  }
+}
+
+/* Roll back everything negotiated with a peer, TX and RX alike, in both
+ * data slotframes */
+static void
+remove_all_links_with(const linkaddr_t *peer_addr)
+{
+  static const uint16_t handles[] = {
+    SF_SIMPLE_UPLINK_SF_HANDLE, SF_SIMPLE_DOWNLINK_SF_HANDLE
+  };
+  struct tsch_slotframe *slotframe;
+  struct tsch_link *l;
+  struct tsch_link *next;
+  uint16_t timeslot;
+  int i;
+
+  for(i = 0; i < (int)(sizeof(handles) / sizeof(handles[0])); i++) {
+    slotframe = tsch_schedule_get_slotframe_by_handle(handles[i]);
+    if(slotframe == NULL) {
+      continue;
+    }
+
+    for(l = list_head(slotframe->links_list); l != NULL; l = next) {
+      next = list_item_next(l);
+      if(linkaddr_cmp(&l->addr, peer_addr)) {
+        timeslot = l->timeslot;
+        tsch_schedule_remove_link(slotframe, l);
+        occupancy_clear(slotframe, timeslot);
+#if SF_SIMPLE_CELL_STATS
+        cell_stats_remove(slotframe->handle, timeslot);
+#endif /* SF_SIMPLE_CELL_STATS */
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+timeout(sixp_pkt_cmd_t cmd, const linkaddr_t *peer_addr)
+{
+  sf_simple_request_t *req = request_find(peer_addr);
+
+  /* the transaction is gone; release whatever body it still owned */
+  trans_buf_free(trans_buf_find(peer_addr));
+#if SF_SIMPLE_CELL_STATS
+  cell_stats_relocation_done(peer_addr);
+#endif /* SF_SIMPLE_CELL_STATS */
+
+  if(req != NULL && req->pending) {
+    /* our request or its response got lost; nothing was installed yet */
+    PRINTF("sf-simple: 6P request %u to node ", cmd);
+    PRINTLLADDR((uip_lladdr_t *)peer_addr);
+    PRINTF(" timed out\r\r\n");
+    request_retry(req);
+  }
+}
+
+static void
+error(sixp_error_t err, sixp_pkt_cmd_t cmd, uint8_t seqno,
+      const linkaddr_t *peer_addr)
+{
+  sf_simple_request_t *req = request_find(peer_addr);
+
+  PRINTF("sf-simple: 6P error %u on command %u (seqno %u) with node ",
+         err, cmd, seqno);
+  PRINTLLADDR((uip_lladdr_t *)peer_addr);
+  PRINTF("\r\r\n");
+
+  trans_buf_free(trans_buf_find(peer_addr));
+#if SF_SIMPLE_CELL_STATS
+  cell_stats_relocation_done(peer_addr);
+#endif /* SF_SIMPLE_CELL_STATS */
+
+  if(err == SIXP_ERROR_SCHEDULE_INCONSISTENCY) {
+    /* drop what we share with the peer; cells are negotiated again from
+     * scratch by the pending request or the adaptive allocator */
+    remove_all_links_with(peer_addr);
+  }
+  if(req != NULL && req->pending) {
+    request_retry(req);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Drops every request, transaction buffer and statistic kept about the
+ * neighbours, leaving the schedule alone */
+static void
+forget_peers(void)
+{
+  int i;
+
+  memb_init(&trans_buf_memb);
+  list_init(trans_buf_list);
+  for(i = 0; i < SF_SIMPLE_MAX_TRANSACTIONS; i++) {
+    ctimer_stop(&requests[i].retry_timer);
+    requests[i].in_use = 0;
+    requests[i].pending = 0;
+  }
+
+#if SF_SIMPLE_ADAPTIVE
+  memset(peers, 0, sizeof(peers));
+#endif /* SF_SIMPLE_ADAPTIVE */
+#if SF_SIMPLE_CELL_STATS
+  memset(cell_stats, 0, sizeof(cell_stats));
+  memset(rx_stats, 0, sizeof(rx_stats));
+#endif /* SF_SIMPLE_CELL_STATS */
+#if SF_SIMPLE_AUTONOMOUS
+  linkaddr_copy(&autonomous_tx_addr, &linkaddr_null);
+#endif /* SF_SIMPLE_AUTONOMOUS */
+  since_sync = 0;
+}
+
+static void
+init(void)
+{
+  /* the schedule may have been rebuilt since; resync the bitmaps lazily */
+  memset(occupancy, 0, sizeof(occupancy));
+  forget_peers();
+#if SF_SIMPLE_ADAPTIVE || SF_SIMPLE_CELL_STATS
+  netstack_sniffer_add(&sf_simple_sniffer);
+#endif
+  linkaddr_copy(&last_time_source, &linkaddr_null);
+  ctimer_set(&housekeeping_timer, SF_SIMPLE_HOUSEKEEPING_PERIOD,
+             housekeeping, NULL);
+}
+
 const sixtop_sf_t sf_simple_driver = {
   SF_SIMPLE_SFID,
   CLOCK_SECOND,
-  NULL,
+  init,
   input,
-  NULL,
-  NULL
+  timeout,
+  error
 };
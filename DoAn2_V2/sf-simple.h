@@ -45,9 +45,279 @@
 
 int sf_simple_add_links(linkaddr_t *peer_addr, uint8_t num_links);
 int sf_simple_remove_links(linkaddr_t *peer_addr);
+int sf_simple_sync_links(linkaddr_t *peer_addr);
+int sf_simple_clear_links(linkaddr_t *peer_addr);
+void sf_simple_print_cells(void);
+/* Unicast frames received from peer_addr, counted against the given data
+ * slotframe (SF_SIMPLE_CELL_STATS) */
+uint16_t sf_simple_rx_frames(const linkaddr_t *peer_addr, uint16_t handle);
+int sf_simple_callback_packet_ready(void);
 
-#define SF_SIMPLE_MAX_LINKS  3
+struct tsch_neighbor;
+void sf_simple_callback_new_time_source(const struct tsch_neighbor *old,
+                                        const struct tsch_neighbor *new);
+
+/* Largest cell bundle (and candidate list) carried by one 6P transaction */
+#ifdef SF_SIMPLE_CONF_MAX_LINKS
+#define SF_SIMPLE_MAX_LINKS SF_SIMPLE_CONF_MAX_LINKS
+#else
+#define SF_SIMPLE_MAX_LINKS  6
+#endif
 #define SF_SIMPLE_SFID       0xf0
+
+/* 6P transactions sf-simple can carry at once, i.e. distinct neighbours
+ * negotiating with us in parallel; each one holds a body buffer */
+#ifdef SF_SIMPLE_CONF_MAX_TRANSACTIONS
+#define SF_SIMPLE_MAX_TRANSACTIONS SF_SIMPLE_CONF_MAX_TRANSACTIONS
+#else
+#define SF_SIMPLE_MAX_TRANSACTIONS 4
+#endif
+
+/* Retries of a failed or timed-out ADD/DELETE before giving up; retry n
+ * waits SF_SIMPLE_RETRY_BACKOFF << (n - 1) plus as much random jitter */
+#ifdef SF_SIMPLE_CONF_MAX_RETRIES
+#define SF_SIMPLE_MAX_RETRIES SF_SIMPLE_CONF_MAX_RETRIES
+#else
+#define SF_SIMPLE_MAX_RETRIES 4
+#endif
+
+#ifdef SF_SIMPLE_CONF_RETRY_BACKOFF
+#define SF_SIMPLE_RETRY_BACKOFF SF_SIMPLE_CONF_RETRY_BACKOFF
+#else
+#define SF_SIMPLE_RETRY_BACKOFF (2 * CLOCK_SECOND)
+#endif
+
+/* Channel offsets candidate cells are drawn from; one per hopping sequence
+ * entry by default so negotiated cells spread over the whole sequence */
+#ifdef SF_SIMPLE_CONF_NUM_CHANNEL_OFFSETS
+#define SF_SIMPLE_NUM_CHANNEL_OFFSETS SF_SIMPLE_CONF_NUM_CHANNEL_OFFSETS
+#else
+#define SF_SIMPLE_NUM_CHANNEL_OFFSETS sizeof(TSCH_DEFAULT_HOPPING_SEQUENCE)
+#endif
+
+/* Longest slotframe the occupancy bitmap covers; timeslots beyond it are
+ * never proposed nor accepted */
+#ifdef SF_SIMPLE_CONF_MAX_TIMESLOTS
+#define SF_SIMPLE_MAX_TIMESLOTS SF_SIMPLE_CONF_MAX_TIMESLOTS
+#else
+#define SF_SIMPLE_MAX_TIMESLOTS 256
+#endif
+
+/* Slotframes. The control one is the 6TiSCH minimal slotframe, shared by
+ * EBs, broadcast and 6P; negotiated cells go to the uplink slotframe when
+ * the peer is our time source and to the downlink one otherwise. Lengths
+ * are coprime with each other and with the minimal slotframe so that
+ * overlapping cells do not always collide; on overlap TSCH serves the
+ * lowest handle first. */
+#define SF_SIMPLE_CONTROL_SF_HANDLE 0
+
+#ifdef SF_SIMPLE_CONF_UPLINK_SF_HANDLE
+#define SF_SIMPLE_UPLINK_SF_HANDLE SF_SIMPLE_CONF_UPLINK_SF_HANDLE
+#else
+#define SF_SIMPLE_UPLINK_SF_HANDLE 1
+#endif
+
+#ifdef SF_SIMPLE_CONF_UPLINK_SF_LENGTH
+#define SF_SIMPLE_UPLINK_SF_LENGTH SF_SIMPLE_CONF_UPLINK_SF_LENGTH
+#else
+#define SF_SIMPLE_UPLINK_SF_LENGTH 11
+#endif
+
+#ifdef SF_SIMPLE_CONF_DOWNLINK_SF_HANDLE
+#define SF_SIMPLE_DOWNLINK_SF_HANDLE SF_SIMPLE_CONF_DOWNLINK_SF_HANDLE
+#else
+#define SF_SIMPLE_DOWNLINK_SF_HANDLE 2
+#endif
+
+#ifdef SF_SIMPLE_CONF_DOWNLINK_SF_LENGTH
+#define SF_SIMPLE_DOWNLINK_SF_LENGTH SF_SIMPLE_CONF_DOWNLINK_SF_LENGTH
+#else
+#define SF_SIMPLE_DOWNLINK_SF_LENGTH 17
+#endif
+
+/* Autonomous cells: every node listens in a shared cell of the autonomous
+ * slotframe picked from a hash of its own link-layer address, and gets a
+ * TX cell to the receiver cell of its parent as soon as RPL selects one. It
+ * carries unicast until a negotiated cell to the parent exists. */
+#ifdef SF_SIMPLE_CONF_AUTONOMOUS
+#define SF_SIMPLE_AUTONOMOUS SF_SIMPLE_CONF_AUTONOMOUS
+#else
+#define SF_SIMPLE_AUTONOMOUS 1
+#endif
+
+#ifdef SF_SIMPLE_CONF_AUTONOMOUS_SF_HANDLE
+#define SF_SIMPLE_AUTONOMOUS_SF_HANDLE SF_SIMPLE_CONF_AUTONOMOUS_SF_HANDLE
+#else
+#define SF_SIMPLE_AUTONOMOUS_SF_HANDLE 3
+#endif
+
+#ifdef SF_SIMPLE_CONF_AUTONOMOUS_SF_LENGTH
+#define SF_SIMPLE_AUTONOMOUS_SF_LENGTH SF_SIMPLE_CONF_AUTONOMOUS_SF_LENGTH
+#else
+#define SF_SIMPLE_AUTONOMOUS_SF_LENGTH 13
+#endif
+
+/* One channel offset for all autonomous cells, so that a node never has to
+ * send and receive in the same timeslot on two channels */
+#ifdef SF_SIMPLE_CONF_AUTONOMOUS_CHANNEL_OFFSET
+#define SF_SIMPLE_AUTONOMOUS_CHANNEL_OFFSET SF_SIMPLE_CONF_AUTONOMOUS_CHANNEL_OFFSET
+#else
+#define SF_SIMPLE_AUTONOMOUS_CHANNEL_OFFSET 1
+#endif
+
+/* Number of slotframes with an occupancy bitmap: the two data ones */
+#ifdef SF_SIMPLE_CONF_MAX_SLOTFRAMES
+#define SF_SIMPLE_MAX_SLOTFRAMES SF_SIMPLE_CONF_MAX_SLOTFRAMES
+#else
+#define SF_SIMPLE_MAX_SLOTFRAMES 2
+#endif
+
+/* Traffic-adaptive allocation: sample the TSCH queue of every neighbour we
+ * send to once per period, and after a window of samples ADD a cell when the
+ * neighbour is backlogged or DELETE one when its cells sit idle. */
+#ifdef SF_SIMPLE_CONF_ADAPTIVE
+#define SF_SIMPLE_ADAPTIVE SF_SIMPLE_CONF_ADAPTIVE
+#else
+#define SF_SIMPLE_ADAPTIVE 1
+#endif
+
+#ifdef SF_SIMPLE_CONF_HOUSEKEEPING_PERIOD
+#define SF_SIMPLE_HOUSEKEEPING_PERIOD SF_SIMPLE_CONF_HOUSEKEEPING_PERIOD
+#else
+#define SF_SIMPLE_HOUSEKEEPING_PERIOD CLOCK_SECOND
+#endif
+
+/* Number of housekeeping samples per decision window */
+#ifdef SF_SIMPLE_CONF_WINDOW
+#define SF_SIMPLE_WINDOW SF_SIMPLE_CONF_WINDOW
+#else
+#define SF_SIMPLE_WINDOW 10
+#endif
+
+/* Neighbours tracked at once; the time source always gets an entry */
+#ifdef SF_SIMPLE_CONF_MAX_PEERS
+#define SF_SIMPLE_MAX_PEERS SF_SIMPLE_CONF_MAX_PEERS
+#else
+#define SF_SIMPLE_MAX_PEERS 4
+#endif
+
+/* Dedicated TX cells kept to the time source even when idle */
+#ifdef SF_SIMPLE_CONF_MIN_CELLS
+#define SF_SIMPLE_MIN_CELLS SF_SIMPLE_CONF_MIN_CELLS
+#else
+#define SF_SIMPLE_MIN_CELLS 1
+#endif
+
+/* Upper bound of dedicated TX cells towards a single neighbour */
+#ifdef SF_SIMPLE_CONF_MAX_CELLS
+#define SF_SIMPLE_MAX_CELLS SF_SIMPLE_CONF_MAX_CELLS
+#else
+#define SF_SIMPLE_MAX_CELLS 4
+#endif
+
+/* Average queue occupancy (packets) above which a cell is added */
+#ifdef SF_SIMPLE_CONF_QUEUE_THRESHOLD
+#define SF_SIMPLE_QUEUE_THRESHOLD SF_SIMPLE_CONF_QUEUE_THRESHOLD
+#else
+#define SF_SIMPLE_QUEUE_THRESHOLD 2
+#endif
+
+/* Cell usage (percent of TX opportunities) bounds for ADD / DELETE. A
+ * neighbour without cells gets its first one once the frames sent to it
+ * would keep one cell at SF_SIMPLE_USAGE_LOW. */
+#ifdef SF_SIMPLE_CONF_USAGE_HIGH
+#define SF_SIMPLE_USAGE_HIGH SF_SIMPLE_CONF_USAGE_HIGH
+#else
+#define SF_SIMPLE_USAGE_HIGH 75
+#endif
+
+#ifdef SF_SIMPLE_CONF_USAGE_LOW
+#define SF_SIMPLE_USAGE_LOW SF_SIMPLE_CONF_USAGE_LOW
+#else
+#define SF_SIMPLE_USAGE_LOW 25
+#endif
+
+/* Windows in a row a neighbour must leave its cells below
+ * SF_SIMPLE_USAGE_LOW, with an empty queue, before one is deleted */
+#ifdef SF_SIMPLE_CONF_IDLE_WINDOWS
+#define SF_SIMPLE_IDLE_WINDOWS SF_SIMPLE_CONF_IDLE_WINDOWS
+#else
+#define SF_SIMPLE_IDLE_WINDOWS 3
+#endif
+
+/* Per-cell delivery and usage statistics of the TX cells, and frames
+ * received per neighbour, the usage printed by sf_simple_print_cells().
+ * Unicast frames are pinned to one of the dedicated TX cells of their
+ * neighbour, which needs TSCH_CONF_WITH_LINK_SELECTOR and
+ * TSCH_CALLBACK_PACKET_READY set to sf_simple_callback_packet_ready or a
+ * function calling it. A project can define
+ * SF_SIMPLE_CALLBACK_PIN_PACKET to a function returning 0 for the frames
+ * that should rather take the first cell to their neighbour. */
+#ifdef SF_SIMPLE_CONF_CELL_STATS
+#define SF_SIMPLE_CELL_STATS SF_SIMPLE_CONF_CELL_STATS
+#else
+#define SF_SIMPLE_CELL_STATS 1
+#endif
+
+/* Cells with statistics at once */
+#ifdef SF_SIMPLE_CONF_MAX_CELL_STATS
+#define SF_SIMPLE_MAX_CELL_STATS SF_SIMPLE_CONF_MAX_CELL_STATS
+#else
+#define SF_SIMPLE_MAX_CELL_STATS (SF_SIMPLE_MAX_PEERS * SF_SIMPLE_MAX_CELLS)
+#endif
+
+/* Delivery counters of a cell are halved once it carried that many frames
+ * so that they follow the recent state of the channel */
+#ifdef SF_SIMPLE_CONF_CELL_STATS_WINDOW
+#define SF_SIMPLE_CELL_STATS_WINDOW SF_SIMPLE_CONF_CELL_STATS_WINDOW
+#else
+#define SF_SIMPLE_CELL_STATS_WINDOW 128
+#endif
+
+/* Move a TX cell to a fresh one with 6P RELOCATE when its delivery ratio
+ * drops below SF_SIMPLE_RELOCATE_PDR_RATIO percent of the bundle average,
+ * or below SF_SIMPLE_RELOCATE_MIN_PDR percent, once it carried at least
+ * SF_SIMPLE_RELOCATE_MIN_TX frames */
+#ifdef SF_SIMPLE_CONF_RELOCATE
+#define SF_SIMPLE_RELOCATE SF_SIMPLE_CONF_RELOCATE
+#else
+#define SF_SIMPLE_RELOCATE SF_SIMPLE_CELL_STATS
+#endif
+
+#ifdef SF_SIMPLE_CONF_RELOCATE_MIN_TX
+#define SF_SIMPLE_RELOCATE_MIN_TX SF_SIMPLE_CONF_RELOCATE_MIN_TX
+#else
+#define SF_SIMPLE_RELOCATE_MIN_TX 16
+#endif
+
+#ifdef SF_SIMPLE_CONF_RELOCATE_PDR_RATIO
+#define SF_SIMPLE_RELOCATE_PDR_RATIO SF_SIMPLE_CONF_RELOCATE_PDR_RATIO
+#else
+#define SF_SIMPLE_RELOCATE_PDR_RATIO 75
+#endif
+
+#ifdef SF_SIMPLE_CONF_RELOCATE_MIN_PDR
+#define SF_SIMPLE_RELOCATE_MIN_PDR SF_SIMPLE_CONF_RELOCATE_MIN_PDR
+#else
+#define SF_SIMPLE_RELOCATE_MIN_PDR 80
+#endif
+
+/* Period of the COUNT (then LIST if the counts differ) consistency check of
+ * our TX cells with the time source; 0 disables it */
+#ifdef SF_SIMPLE_CONF_SYNC_PERIOD
+#define SF_SIMPLE_SYNC_PERIOD SF_SIMPLE_CONF_SYNC_PERIOD
+#else
+#define SF_SIMPLE_SYNC_PERIOD (60 * CLOCK_SECOND)
+#endif
+
+/* CLEAR whatever a new time source may still hold for us before
+ * negotiating any cell with it */
+#ifdef SF_SIMPLE_CONF_CLEAR_ON_JOIN
+#define SF_SIMPLE_CLEAR_ON_JOIN SF_SIMPLE_CONF_CLEAR_ON_JOIN
+#else
+#define SF_SIMPLE_CLEAR_ON_JOIN 1
+#endif
+
 extern const sixtop_sf_t sf_simple_driver;
 
 #endif /* !_SIXTOP_SF_SIMPLE_H_ */
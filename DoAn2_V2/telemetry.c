@@ -0,0 +1,311 @@
+/**
+ * \file
+ *         Encoding and decoding of the application messages
+ */
+
+#include "telemetry.h"
+
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+put_u16(uint8_t *p, uint16_t v)
+{
+  p[0] = v >> 8;
+  p[1] = v & 0xff;
+  return p + 2;
+}
+
+static uint8_t *
+put_u32(uint8_t *p, uint32_t v)
+{
+  p = put_u16(p, v >> 16);
+  return put_u16(p, v & 0xffff);
+}
+
+static const uint8_t *
+get_u16(const uint8_t *p, uint16_t *v)
+{
+  *v = ((uint16_t)p[0] << 8) | p[1];
+  return p + 2;
+}
+
+static const uint8_t *
+get_u32(const uint8_t *p, uint32_t *v)
+{
+  uint16_t hi;
+  uint16_t lo;
+
+  p = get_u16(p, &hi);
+  p = get_u16(p, &lo);
+  *v = ((uint32_t)hi << 16) | lo;
+  return p;
+}
+
+static uint8_t *
+put_energy(uint8_t *p, const telemetry_sensor_t *report)
+{
+  p = put_u16(p, report->cpu);
+  p = put_u16(p, report->lpm);
+  p = put_u16(p, report->listen);
+  return put_u16(p, report->transmit);
+}
+
+/* Duty cycles are absent from the messages of older nodes */
+static const uint8_t *
+get_energy(const uint8_t *p, const uint8_t *end, telemetry_sensor_t *report)
+{
+  if(end - p < TELEMETRY_ENERGY_LEN) {
+    report->cpu = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+    report->lpm = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+    report->listen = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+    report->transmit = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+    return p;
+  }
+  p = get_u16(p, &report->cpu);
+  p = get_u16(p, &report->lpm);
+  p = get_u16(p, &report->listen);
+  return get_u16(p, &report->transmit);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+telemetry_short_id(const uip_ipaddr_t *addr)
+{
+  return ((uint16_t)addr->u8[14] << 8) | addr->u8[15];
+}
+
+int
+telemetry_type(const uint8_t *buf, uint16_t len)
+{
+  if(len < TELEMETRY_HEADER_LEN || buf[1] != TELEMETRY_VERSION) {
+    return -1;
+  }
+  return buf[0] & ~TELEMETRY_FLAG_TRACE;
+}
+/*---------------------------------------------------------------------------*/
+int
+telemetry_trace_start(uint8_t *buf, uint16_t len, uint16_t size)
+{
+  if(len < TELEMETRY_HEADER_LEN || len >= size) {
+    return -1;
+  }
+  buf[0] |= TELEMETRY_FLAG_TRACE;
+  buf[len] = 0;
+  return len + 1;
+}
+
+void
+telemetry_hop_encode(const telemetry_hop_t *hop, uint8_t *buf)
+{
+  buf = put_u16(buf, hop->id);
+  buf = put_u32(buf, hop->asn);
+  *buf = hop->queue;
+}
+
+int
+telemetry_trace_strip(telemetry_hop_t *hops, uint8_t max,
+                      const uint8_t *buf, uint16_t *len)
+{
+  const uint8_t *p;
+  uint8_t count;
+  uint8_t i;
+
+  if(*len < TELEMETRY_HEADER_LEN || !(buf[0] & TELEMETRY_FLAG_TRACE)) {
+    return 0;
+  }
+
+  count = buf[*len - 1];
+  if(count > max ||
+     *len < TELEMETRY_HEADER_LEN + 1 + count * TELEMETRY_HOP_LEN) {
+    return -1;
+  }
+
+  *len -= 1 + count * TELEMETRY_HOP_LEN;
+  p = buf + *len;
+  for(i = 0; i < count; i++) {
+    p = get_u16(p, &hops[i].id);
+    p = get_u32(p, &hops[i].asn);
+    hops[i].queue = *p++;
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+int
+telemetry_sensor_encode(const telemetry_sensor_t *report,
+                        uint8_t *buf, uint16_t len)
+{
+  uint8_t *p = buf;
+
+  if(len < TELEMETRY_SENSOR_LEN) {
+    return -1;
+  }
+
+  *p++ = TELEMETRY_TYPE_SENSOR;
+  *p++ = TELEMETRY_VERSION;
+  p = put_u16(p, report->node_id);
+  p = put_u16(p, report->tx_count);
+  p = put_u16(p, report->rx_count);
+  p = put_u32(p, report->asn);
+  p = put_u16(p, (uint16_t)report->temperature);
+  p = put_u16(p, report->parent_id);
+  p = put_u16(p, report->ping_sent);
+  p = put_u16(p, report->pong_received);
+  p = put_u16(p, report->rtt);
+  p = put_energy(p, report);
+  return p - buf;
+}
+
+int
+telemetry_sensor_decode(telemetry_sensor_t *report,
+                        const uint8_t *buf, uint16_t len)
+{
+  const uint8_t *p = buf + TELEMETRY_HEADER_LEN;
+  uint16_t temperature;
+
+  if(telemetry_type(buf, len) != TELEMETRY_TYPE_SENSOR ||
+     len < TELEMETRY_SENSOR_BASE_LEN) {
+    return -1;
+  }
+
+  p = get_u16(p, &report->node_id);
+  p = get_u16(p, &report->tx_count);
+  p = get_u16(p, &report->rx_count);
+  p = get_u32(p, &report->asn);
+  p = get_u16(p, &temperature);
+  report->temperature = (int16_t)temperature;
+  p = get_u16(p, &report->parent_id);
+  p = get_u16(p, &report->ping_sent);
+  p = get_u16(p, &report->pong_received);
+  p = get_u16(p, &report->rtt);
+  get_energy(p, buf + len, report);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+telemetry_probe_encode(uint8_t type, const telemetry_probe_t *probe,
+                       uint8_t *buf, uint16_t len)
+{
+  uint8_t *p = buf;
+
+  if(len < TELEMETRY_PROBE_LEN) {
+    return -1;
+  }
+
+  *p++ = type;
+  *p++ = TELEMETRY_VERSION;
+  p = put_u16(p, probe->seq);
+  p = put_u32(p, probe->timestamp);
+  return p - buf;
+}
+
+int
+telemetry_probe_decode(uint8_t type, telemetry_probe_t *probe,
+                       const uint8_t *buf, uint16_t len)
+{
+  const uint8_t *p = buf + TELEMETRY_HEADER_LEN;
+
+  if(telemetry_type(buf, len) != type || len < TELEMETRY_PROBE_LEN) {
+    return -1;
+  }
+
+  p = get_u16(p, &probe->seq);
+  get_u32(p, &probe->timestamp);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+telemetry_batch_fits(const telemetry_sample_t *prev,
+                     const telemetry_sample_t *next)
+{
+  int16_t dt = next->temperature - prev->temperature;
+
+  return next->asn - prev->asn <= 0xffff && dt >= INT8_MIN && dt <= INT8_MAX;
+}
+
+int
+telemetry_batch_encode(const telemetry_sensor_t *last,
+                       const telemetry_sample_t *samples, uint8_t count,
+                       uint8_t *buf, uint16_t len)
+{
+  uint8_t *p = buf;
+  uint8_t i;
+
+  if(count == 0 || count > TELEMETRY_BATCH_MAX ||
+     len < TELEMETRY_BATCH_LEN(count)) {
+    return -1;
+  }
+  for(i = 1; i < count; i++) {
+    if(!telemetry_batch_fits(&samples[i - 1], &samples[i])) {
+      return -1;
+    }
+  }
+
+  *p++ = TELEMETRY_TYPE_BATCH;
+  *p++ = TELEMETRY_VERSION;
+  p = put_u16(p, last->node_id);
+  p = put_u16(p, last->tx_count);
+  p = put_u16(p, last->rx_count);
+  p = put_u16(p, last->parent_id);
+  p = put_u16(p, last->ping_sent);
+  p = put_u16(p, last->pong_received);
+  p = put_u16(p, last->rtt);
+  *p++ = count;
+  p = put_u32(p, samples[0].asn);
+  p = put_u16(p, (uint16_t)samples[0].temperature);
+  for(i = 1; i < count; i++) {
+    p = put_u16(p, samples[i].asn - samples[i - 1].asn);
+    *p++ = (uint8_t)(int8_t)(samples[i].temperature - samples[i - 1].temperature);
+  }
+  p = put_energy(p, last);
+  return p - buf;
+}
+
+int
+telemetry_batch_decode(telemetry_sensor_t *reports, uint8_t max,
+                       const uint8_t *buf, uint16_t len)
+{
+  const uint8_t *p = buf + TELEMETRY_HEADER_LEN;
+  telemetry_sensor_t last;
+  uint16_t temperature;
+  uint16_t delta;
+  uint8_t count;
+  uint8_t i;
+
+  if(telemetry_type(buf, len) != TELEMETRY_TYPE_BATCH ||
+     len < TELEMETRY_BATCH_BASE_LEN(1)) {
+    return -1;
+  }
+
+  p = get_u16(p, &last.node_id);
+  p = get_u16(p, &last.tx_count);
+  p = get_u16(p, &last.rx_count);
+  p = get_u16(p, &last.parent_id);
+  p = get_u16(p, &last.ping_sent);
+  p = get_u16(p, &last.pong_received);
+  p = get_u16(p, &last.rtt);
+  count = *p++;
+  if(count == 0 || count > max || len < TELEMETRY_BATCH_BASE_LEN(count)) {
+    return -1;
+  }
+  get_energy(buf + TELEMETRY_BATCH_BASE_LEN(count), buf + len, &last);
+
+  for(i = 0; i < count; i++) {
+    reports[i] = last;
+    reports[i].tx_count = last.tx_count - (count - 1 - i);
+    if(i < count - 1) {
+      reports[i].cpu = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+      reports[i].lpm = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+      reports[i].listen = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+      reports[i].transmit = TELEMETRY_DUTY_CYCLE_UNKNOWN;
+    }
+    if(i == 0) {
+      p = get_u32(p, &reports[i].asn);
+      p = get_u16(p, &temperature);
+      reports[i].temperature = (int16_t)temperature;
+    } else {
+      p = get_u16(p, &delta);
+      reports[i].asn = reports[i - 1].asn + delta;
+      reports[i].temperature = reports[i - 1].temperature + (int8_t)*p++;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,154 @@
+/**
+ * \file
+ *         Wire format of the application messages exchanged between the
+ *         sensor nodes and the coordinator
+ *
+ * Every message starts with a type byte and a version byte. Multi-byte
+ * fields are big-endian (network byte order) and never padded; a decoder
+ * accepts longer messages of its version, so fields can be appended later
+ * without breaking older coordinators.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "contiki.h"
+#include "net/ipv6/uip.h"
+
+#define TELEMETRY_VERSION 1
+
+/* Message types */
+#define TELEMETRY_TYPE_SENSOR 0x01
+#define TELEMETRY_TYPE_BATCH  0x02
+#define TELEMETRY_TYPE_PING   0x03
+#define TELEMETRY_TYPE_PONG   0x04
+
+/* Set in the type byte of a message collecting a per-hop trace: every node
+ * it goes through, its source included, appends a hop record before the
+ * trailing record count */
+#define TELEMETRY_FLAG_TRACE  0x80
+#define TELEMETRY_TRACE_MAX_HOPS 8
+/* Short ID (uint16), ASN the node queued the packet at (uint32), and the
+ * number of frames already queued to the next hop (uint8) */
+#define TELEMETRY_HOP_LEN 7
+
+/* Length of the type and version bytes */
+#define TELEMETRY_HEADER_LEN 2
+/* Duty cycles of the CPU, low-power mode, radio listen and radio transmit
+ * (uint16 each), appended to reports and batches */
+#define TELEMETRY_ENERGY_LEN 8
+/* Length of a sensor report, and of one without duty cycles */
+#define TELEMETRY_SENSOR_LEN (TELEMETRY_SENSOR_BASE_LEN + TELEMETRY_ENERGY_LEN)
+#define TELEMETRY_SENSOR_BASE_LEN (TELEMETRY_HEADER_LEN + 20)
+
+/* Duty cycles are in units of 1/10000 of the time since the previous
+ * report; a report without them decodes to this value */
+#define TELEMETRY_DUTY_CYCLE_SCALE 10000
+#define TELEMETRY_DUTY_CYCLE_UNKNOWN 0xffff
+
+/* A batch carries the counters of the last sample, the first sample in
+ * full, then each following one as an ASN delta (uint16) and a
+ * temperature delta (int8) from the previous one, and the duty cycles */
+#define TELEMETRY_BATCH_MAX 16
+#define TELEMETRY_BATCH_LEN(n) \
+  (TELEMETRY_BATCH_BASE_LEN(n) + TELEMETRY_ENERGY_LEN)
+#define TELEMETRY_BATCH_BASE_LEN(n) \
+  (TELEMETRY_HEADER_LEN + 15 + 6 + 3 * ((n) - 1))
+
+/* A sensor report, as the application sees it */
+typedef struct {
+  uint16_t node_id;         // Node ID
+  uint16_t tx_count;        // Transmission count
+  uint16_t rx_count;        // Reception count (PONG received)
+  uint32_t asn;             // Send time, 32 least significant bits of the ASN
+  int16_t temperature;      // Temperature in Celsius
+  uint16_t parent_id;       // Short ID of the parent, 0 when there is none
+  uint16_t ping_sent;       // Total PINGs sent
+  uint16_t pong_received;   // Total PONGs received
+  uint16_t rtt;             // Round-Trip Time in ms
+  uint16_t cpu;             // CPU duty cycle, in TELEMETRY_DUTY_CYCLE_SCALE units
+  uint16_t lpm;             // Low-power mode duty cycle
+  uint16_t listen;          // Radio listen duty cycle
+  uint16_t transmit;        // Radio transmit duty cycle
+} telemetry_sensor_t;
+
+/* A PING probe, or the PONG answering it: the PONG echoes the sequence
+ * number and the sender timestamp of its PING */
+#define TELEMETRY_PROBE_LEN (TELEMETRY_HEADER_LEN + 6)
+
+typedef struct {
+  uint16_t seq;             // Probe sequence number
+  uint32_t timestamp;       // Sender clock at PING time, opaque to the peer
+} telemetry_probe_t;
+
+/* One hop record of a trace */
+typedef struct {
+  uint16_t id;              // Short ID of the node
+  uint32_t asn;             // ASN the packet was queued at, 32 least significant bits
+  uint8_t queue;            // Frames queued before it to the next hop
+} telemetry_hop_t;
+
+/* One sample of a batch */
+typedef struct {
+  uint32_t asn;             // Sample time, 32 least significant bits of the ASN
+  int16_t temperature;      // Temperature in Celsius
+} telemetry_sample_t;
+
+/* Short ID of a node: the last two bytes of its interface identifier,
+ * i.e. the node ID on the usual platforms */
+uint16_t telemetry_short_id(const uip_ipaddr_t *addr);
+
+/* Type of a message, trace flag aside, or -1 if it is not a telemetry
+ * message */
+int telemetry_type(const uint8_t *buf, uint16_t len);
+
+/* Write a sensor report to buf; returns its length, or -1 if buf is too
+ * short */
+int telemetry_sensor_encode(const telemetry_sensor_t *report,
+                            uint8_t *buf, uint16_t len);
+
+/* Read a sensor report from buf; returns 0, or -1 if the message is not a
+ * sensor report this version understands */
+int telemetry_sensor_decode(telemetry_sensor_t *report,
+                            const uint8_t *buf, uint16_t len);
+
+/* Write a probe of the given type (PING or PONG) to buf; returns its
+ * length, or -1 if buf is too short */
+int telemetry_probe_encode(uint8_t type, const telemetry_probe_t *probe,
+                           uint8_t *buf, uint16_t len);
+
+/* Read a probe of the given type from buf; returns 0, or -1 if the message
+ * is not such a probe */
+int telemetry_probe_decode(uint8_t type, telemetry_probe_t *probe,
+                           const uint8_t *buf, uint16_t len);
+
+/* Turn the message of len bytes in buf into one collecting a trace;
+ * returns its new length, or -1 if buf is too short */
+int telemetry_trace_start(uint8_t *buf, uint16_t len, uint16_t size);
+
+/* Write a hop record to buf, which must hold TELEMETRY_HOP_LEN bytes */
+void telemetry_hop_encode(const telemetry_hop_t *hop, uint8_t *buf);
+
+/* Take the trace off a message, leaving *len at the length of the message
+ * proper; returns the number of hop records stored in hops, 0 if the message
+ * collects no trace, or -1 if the trace is malformed */
+int telemetry_trace_strip(telemetry_hop_t *hops, uint8_t max,
+                          const uint8_t *buf, uint16_t *len);
+
+/* Whether next can follow prev in a batch, i.e. its deltas fit */
+int telemetry_batch_fits(const telemetry_sample_t *prev,
+                         const telemetry_sample_t *next);
+
+/* Write a batch of count samples to buf, the asn and temperature of last
+ * being ignored; returns its length, or -1 if it cannot be encoded */
+int telemetry_batch_encode(const telemetry_sensor_t *last,
+                           const telemetry_sample_t *samples, uint8_t count,
+                           uint8_t *buf, uint16_t len);
+
+/* Unpack a batch into one report per sample, tx_count counting back from
+ * the last one, which alone carries the duty cycles; returns the number of reports, or -1 if the message is not
+ * a batch this version understands */
+int telemetry_batch_decode(telemetry_sensor_t *reports, uint8_t max,
+                           const uint8_t *buf, uint16_t len);
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,213 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<simconf version="2023090101">
+  <simulation>
+    <title>DoAn2 adaptive cells (stepped traffic)</title>
+    <speedlimit>20.0</speedlimit>
+    <randomseed>123456</randomseed>
+    <motedelay_us>1000000</motedelay_us>
+    <radiomedium>
+      org.contikios.cooja.radiomediums.UDGM
+      <transmitting_range>50.0</transmitting_range>
+      <interference_range>100.0</interference_range>
+      <success_ratio_tx>1.0</success_ratio_tx>
+      <success_ratio_rx>1.0</success_ratio_rx>
+    </radiomedium>
+    <events>
+      <logoutput>40000</logoutput>
+    </events>
+    <motetype>
+      org.contikios.cooja.contikimote.ContikiMoteType
+      <description>Cooja Mote Type #1</description>
+      <source>[CONFIG_DIR]/coordinator.c</source>
+      <commands>$(MAKE) -j$(CPUS) coordinator.cooja TARGET=cooja</commands>
+      <moteinterface>org.contikios.cooja.interfaces.Position</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.Battery</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiVib</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiMoteID</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiRS232</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiBeeper</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.IPAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiRadio</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiButton</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiPIR</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiClock</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiLED</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiCFS</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiEEPROM</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.Mote2MoteRelations</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.MoteAttributes</moteinterface>
+      <mote>
+        <interface_config>
+          org.contikios.cooja.interfaces.Position
+          <pos x="112.11165506071225" y="44.78539879590109" />
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.contikimote.interfaces.ContikiMoteID
+          <id>1</id>
+        </interface_config>
+      </mote>
+    </motetype>
+    <motetype>
+      org.contikios.cooja.contikimote.ContikiMoteType
+      <description>Cooja Mote Type #2</description>
+      <source>[CONFIG_DIR]/node.c</source>
+      <commands>$(MAKE) -j$(CPUS) node.cooja TARGET=cooja DEFINES=NODE_CONF_TRAFFIC_STEPS=1</commands>
+      <moteinterface>org.contikios.cooja.interfaces.Position</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.Battery</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiVib</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiMoteID</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiRS232</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiBeeper</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.IPAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiRadio</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiButton</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiPIR</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiClock</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiLED</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiCFS</moteinterface>
+      <moteinterface>org.contikios.cooja.contikimote.interfaces.ContikiEEPROM</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.Mote2MoteRelations</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.MoteAttributes</moteinterface>
+      <mote>
+        <interface_config>
+          org.contikios.cooja.interfaces.Position
+          <pos x="79.38495839074405" y="70.53525609954025" />
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.contikimote.interfaces.ContikiMoteID
+          <id>2</id>
+        </interface_config>
+      </mote>
+      <mote>
+        <interface_config>
+          org.contikios.cooja.interfaces.Position
+          <pos x="144.8680470493397" y="73.45912917882191" />
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.contikimote.interfaces.ContikiMoteID
+          <id>3</id>
+        </interface_config>
+      </mote>
+      <mote>
+        <interface_config>
+          org.contikios.cooja.interfaces.Position
+          <pos x="163.9633095367107" y="113.30525752806655" />
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.contikimote.interfaces.ContikiMoteID
+          <id>4</id>
+        </interface_config>
+      </mote>
+    </motetype>
+  </simulation>
+  <plugin>
+    org.contikios.cooja.plugins.Visualizer
+    <plugin_config>
+      <moterelations>true</moterelations>
+      <skin>org.contikios.cooja.plugins.skins.IDVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.GridVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.TrafficVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.UDGMVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.MoteTypeVisualizerSkin</skin>
+      <viewport>2.4169949137185256 0.0 0.0 2.4169949137185256 -147.29122661534024 -3.0130140763453657</viewport>
+    </plugin_config>
+    <bounds x="-21" y="5" height="400" width="293" z="2" />
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.LogListener
+    <plugin_config>
+      <filter>ID:2</filter>
+      <formatted_time />
+      <coloring />
+    </plugin_config>
+    <bounds x="270" y="5" height="568" width="1396" z="1" />
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.TimeLine
+    <plugin_config>
+      <mote>0</mote>
+      <mote>1</mote>
+      <mote>2</mote>
+      <mote>3</mote>
+      <showRadioRXTX />
+      <showRadioHW />
+      <showLEDs />
+      <zoomfactor>500.0</zoomfactor>
+    </plugin_config>
+    <bounds x="0" y="577" height="166" width="1666" z="3" />
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.ScriptRunner
+    <plugin_config>
+      <script>/* Traffic steps every 300 s (10 s, 2 s, 250 ms, 2 s, 10 s).
+ * Print the traffic step changes and the sf-simple cell count decisions so
+ * the TX cell count can be followed against the offered load, and check
+ * that the adaptive allocator follows it: the TX cells of some node to a
+ * neighbour must grow during the 250 ms step, and every count that grew
+ * must have come down again by the end of the last 10 s step.
+ * (No less-than or ampersand below: this is XML.) */
+var step = {};    /* traffic step of each mote */
+var cells = {};   /* last cell count of each mote to each neighbour */
+var before = {};  /* ... when the 250 ms step started */
+var peak = {};    /* ... highest during the 250 ms step */
+
+function check() {
+  var grown = 0;
+  var k;
+
+  for(k in peak) {
+    if(peak[k] > before[k]) {
+      grown++;
+      log.log(k + ": " + before[k] + " cells, " + peak[k] + " at 250 ms, " +
+              cells[k] + " at the end\n");
+      if(cells[k] >= peak[k]) {
+        log.log("FAIL: the cells of " + k + " did not come down\n");
+        log.testFailed();
+        return;
+      }
+    }
+  }
+  if(grown == 0) {
+    log.log("FAIL: no node got more cells at 250 ms\n");
+    log.testFailed();
+    return;
+  }
+  log.testOK();
+}
+
+TIMEOUT(1560000, check());
+
+while(true) {
+  YIELD();
+  if(msg.contains("Traffic step") || msg.contains("sf-simple: node ")) {
+    log.log((time / 1000000) + " s ID:" + id + " " + msg + "\n");
+  }
+
+  var m = msg.match(/Traffic step (\d+)/);
+  if(m) {
+    step[id] = parseInt(m[1]);
+    continue;
+  }
+  m = msg.match(/sf-simple: node (.*) cells (\d+)/);
+  if(!m || id == 1) {
+    /* the coordinator only answers to the load of its children */
+    continue;
+  }
+  var k = "ID:" + id + " to " + m[1];
+  var n = parseInt(m[2]);
+  if(step[id] == 2) {
+    if(!(k in before)) {
+      before[k] = k in cells ? cells[k] : 0;
+      peak[k] = before[k];
+    }
+    if(n > peak[k]) {
+      peak[k] = n;
+    }
+  }
+  cells[k] = n;
+}</script>
+      <active>true</active>
+    </plugin_config>
+    <bounds x="270" y="577" height="400" width="600" z="0" />
+  </plugin>
+</simconf>
@@ -0,0 +1,411 @@
+/*
+ * Offline analysis of coordinator serial logs (PuTTY captures, Cooja
+ * logs): per-node RTT percentiles, PRR, RSSI and PING loss, plus an
+ * optional CSV time series of the routing table snapshots.
+ *
+ * The log is memory-mapped and cut into one chunk per thread, on line
+ * boundaries. Each thread turns its lines into compact records, and the
+ * records are then aggregated in log order, so the statistics do not
+ * depend on the number of threads.
+ *
+ * Recognised lines:
+ *   Node ID <id> [...] via ... | TX: .. | RX: .. | PRR: ..% | ... | RTT: .. ms
+ *     a row of the routing table, printed every table interval;
+ *   [INFO: Coordinator] Node <id> | TX: .. | RX: .. | ... | RTT: .. ms
+ *     a received report.
+ * A "Routing and Node Statistics:" line starts a new table, which is the
+ * clock of the time series. Lines are matched anywhere, past whatever
+ * prefix the capture adds, such as the time and "ID:1" of Cooja.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr long kAbsent = -1;
+
+enum class RecordKind : uint8_t { kTableRow, kReport };
+
+/* One parsed line; kAbsent marks the fields the line does not carry */
+struct Record {
+  RecordKind kind;
+  uint32_t node_id;
+  uint32_t table;        // Tables started before it, within its chunk
+  long tx = kAbsent;
+  long rx = kAbsent;
+  long prr = kAbsent;
+  long rssi = kAbsent;
+  long ping_sent = kAbsent;
+  long pong_received = kAbsent;
+  long rtt = kAbsent;
+  bool has_rssi = false;
+};
+
+struct Chunk {
+  std::vector<Record> records;
+  uint32_t tables = 0;   // Table headers in the chunk
+};
+
+struct NodeStats {
+  std::vector<uint32_t> report_rtts;  // RTTs of the reports bringing a new PONG
+  std::vector<uint32_t> table_rtts;   // Same, seen from the table rows
+  long report_pongs = kAbsent;
+  long table_pongs = kAbsent;
+  long tx = kAbsent;
+  long rx = kAbsent;
+  long ping_sent = kAbsent;
+  long pong_received = kAbsent;
+  long rssi_sum = 0;
+  long rssi_count = 0;
+  long rssi_min = 0;
+  long rssi_max = 0;
+  long prev_pings = kAbsent;          // Counters at the previous table row
+  long prev_pongs = kAbsent;
+};
+
+struct Options {
+  const char *path = nullptr;
+  const char *csv_path = nullptr;
+  unsigned threads = 0;
+  double interval = 5.0;              // Seconds between two tables
+};
+
+constexpr std::string_view kTableHeader = "Routing and Node Statistics:";
+constexpr std::string_view kTableRow = "Node ID ";
+constexpr std::string_view kReport = "[INFO: Coordinator] Node ";
+
+bool parse_number(std::string_view s, long *value) {
+  size_t i = 0;
+  bool negative = false;
+  while(i < s.size() && s[i] == ' ') {
+    i++;
+  }
+  if(i < s.size() && s[i] == '-') {
+    negative = true;
+    i++;
+  }
+  size_t start = i;
+  long v = 0;
+  while(i < s.size() && s[i] >= '0' && s[i] <= '9') {
+    v = v * 10 + (s[i] - '0');
+    i++;
+  }
+  if(i == start) {
+    return false;
+  }
+  *value = negative ? -v : v;
+  return true;
+}
+
+/* Fill a record from the "| Key: value" fields of a line */
+void parse_fields(std::string_view line, Record *r) {
+  size_t pos = 0;
+  while((pos = line.find("| ", pos)) != std::string_view::npos) {
+    pos += 2;
+    size_t colon = line.find(": ", pos);
+    if(colon == std::string_view::npos) {
+      return;
+    }
+    std::string_view key = line.substr(pos, colon - pos);
+    std::string_view value = line.substr(colon + 2);
+    long *field = nullptr;
+    if(key == "TX") {
+      field = &r->tx;
+    } else if(key == "RX") {
+      field = &r->rx;
+    } else if(key == "PRR") {
+      field = &r->prr;
+    } else if(key == "RSSI") {
+      field = &r->rssi;
+    } else if(key == "PING Sent") {
+      field = &r->ping_sent;
+    } else if(key == "PONG Received") {
+      field = &r->pong_received;
+    } else if(key == "RTT") {
+      field = &r->rtt;
+    }
+    if(field != nullptr && !parse_number(value, field)) {
+      *field = kAbsent;
+    } else if(field == &r->rssi) {
+      r->has_rssi = true;
+    }
+    pos = colon;
+  }
+}
+
+void parse_line(std::string_view line, Chunk *chunk) {
+  size_t at;
+  Record r;
+  if(line.find(kTableHeader) != std::string_view::npos) {
+    chunk->tables++;
+    return;
+  }
+  if((at = line.find(kReport)) != std::string_view::npos) {
+    r.kind = RecordKind::kReport;
+    line.remove_prefix(at + kReport.size());
+  } else if((at = line.find(kTableRow)) != std::string_view::npos) {
+    r.kind = RecordKind::kTableRow;
+    line.remove_prefix(at + kTableRow.size());
+  } else {
+    return;
+  }
+  long id;
+  if(!parse_number(line, &id) || id < 0) {
+    return;
+  }
+  if(r.kind == RecordKind::kTableRow) {
+    /* only rows carry the address; "Node ID <id> | p50: .." is the
+     * latency summary */
+    size_t end = line.find_first_not_of("0123456789");
+    if(end == std::string_view::npos || line.substr(end, 2) != " [") {
+      return;
+    }
+  }
+  r.node_id = id;
+  r.table = chunk->tables;
+  parse_fields(line, &r);
+  chunk->records.push_back(r);
+}
+
+void parse_chunk(const char *begin, const char *end, Chunk *chunk) {
+  while(begin < end) {
+    const char *eol = static_cast<const char *>(memchr(begin, '\n', end - begin));
+    if(eol == nullptr) {
+      eol = end;
+    }
+    std::string_view line(begin, eol - begin);
+    if(!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    parse_line(line, chunk);
+    begin = eol + 1;
+  }
+}
+
+/* Nearest-rank percentile of sorted samples */
+uint32_t percentile(const std::vector<uint32_t> &sorted, unsigned pct) {
+  size_t rank = (sorted.size() * pct + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/* A new PONG since the previous line of the same kind brings a new RTT */
+void add_rtt(std::vector<uint32_t> *rtts, long *last_pongs, const Record &r) {
+  if(r.pong_received == kAbsent) {
+    return;
+  }
+  if(*last_pongs != kAbsent && r.pong_received != *last_pongs && r.rtt > 0) {
+    rtts->push_back(r.rtt);
+  }
+  *last_pongs = r.pong_received;
+}
+
+void write_csv_row(FILE *csv, double time, const Record &r, NodeStats *n) {
+  /* PING loss over the table interval, from the counter increments */
+  std::string loss;
+  if(n->prev_pings != kAbsent && r.ping_sent != kAbsent && r.pong_received != kAbsent &&
+     r.ping_sent > n->prev_pings) {
+    long pings = r.ping_sent - n->prev_pings;
+    long pongs = std::max(0L, std::min(pings, r.pong_received - n->prev_pongs));
+    loss = std::to_string((pings - pongs) * 100 / pings);
+  }
+  n->prev_pings = r.ping_sent;
+  n->prev_pongs = r.pong_received;
+
+  auto field = [](long v) { return v == kAbsent ? std::string() : std::to_string(v); };
+  fprintf(csv, "%.1f,%u,%s,%s,%s,%s,%s,%s,%s,%s\n", time, r.node_id,
+          field(r.tx).c_str(), field(r.rx).c_str(), field(r.prr).c_str(),
+          r.has_rssi ? field(r.rssi).c_str() : "", field(r.rtt).c_str(),
+          field(r.ping_sent).c_str(), field(r.pong_received).c_str(), loss.c_str());
+}
+
+void aggregate(const std::vector<Chunk> &chunks, const Options &opt, FILE *csv,
+               std::map<uint32_t, NodeStats> *nodes) {
+  uint32_t table_offset = 0;
+  for(const Chunk &chunk : chunks) {
+    for(const Record &r : chunk.records) {
+      NodeStats &n = (*nodes)[r.node_id];
+      if(r.kind == RecordKind::kReport) {
+        add_rtt(&n.report_rtts, &n.report_pongs, r);
+        if(r.has_rssi) {
+          n.rssi_min = n.rssi_count == 0 ? r.rssi : std::min(n.rssi_min, r.rssi);
+          n.rssi_max = n.rssi_count == 0 ? r.rssi : std::max(n.rssi_max, r.rssi);
+          n.rssi_sum += r.rssi;
+          n.rssi_count++;
+        }
+      } else {
+        add_rtt(&n.table_rtts, &n.table_pongs, r);
+        if(csv != nullptr) {
+          write_csv_row(csv, (table_offset + r.table) * opt.interval, r, &n);
+        }
+      }
+      if(r.tx != kAbsent) {
+        n.tx = r.tx;
+      }
+      if(r.rx != kAbsent) {
+        n.rx = r.rx;
+      }
+      if(r.ping_sent != kAbsent) {
+        n.ping_sent = r.ping_sent;
+      }
+      if(r.pong_received != kAbsent) {
+        n.pong_received = r.pong_received;
+      }
+    }
+    table_offset += chunk.tables;
+  }
+}
+
+void print_summary(std::map<uint32_t, NodeStats> *nodes) {
+  printf("RTT Stats per Node ID:\n");
+  for(auto &[id, n] : *nodes) {
+    /* Reports carry every RTT; table rows only the last one per interval */
+    std::vector<uint32_t> &rtts = n.report_rtts.empty() ? n.table_rtts : n.report_rtts;
+    std::sort(rtts.begin(), rtts.end());
+    printf("Node ID %u:", id);
+    if(rtts.empty()) {
+      printf(" no RTT samples");
+    } else {
+      double sum = 0;
+      for(uint32_t rtt : rtts) {
+        sum += rtt;
+      }
+      printf(" minRTT=%u ms / aveRTT=%.2f ms / p50=%u ms / p90=%u ms / p99=%u ms / maxRTT=%u ms (%zu samples)",
+             rtts.front(), sum / rtts.size(), percentile(rtts, 50), percentile(rtts, 90),
+             percentile(rtts, 99), rtts.back(), rtts.size());
+    }
+    if(n.tx > 0 && n.rx != kAbsent) {
+      printf(" | PRR: %.1f%%", 100.0 * n.rx / n.tx);
+    }
+    if(n.ping_sent > 0 && n.pong_received != kAbsent) {
+      printf(" | Loss: %.1f%%", 100.0 * (n.ping_sent - n.pong_received) / n.ping_sent);
+    }
+    if(n.rssi_count > 0) {
+      printf(" | RSSI: %.1f dBm (%ld..%ld)", double(n.rssi_sum) / n.rssi_count,
+             n.rssi_min, n.rssi_max);
+    }
+    printf("\n");
+  }
+}
+
+void usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s [-j threads] [-c csv_file] [-i table_interval_s] <log file>\n",
+          name);
+}
+
+bool parse_options(int argc, char **argv, Options *opt) {
+  int c;
+  while((c = getopt(argc, argv, "j:c:i:h")) != -1) {
+    switch(c) {
+    case 'j':
+      opt->threads = strtoul(optarg, nullptr, 10);
+      break;
+    case 'c':
+      opt->csv_path = optarg;
+      break;
+    case 'i':
+      opt->interval = strtod(optarg, nullptr);
+      break;
+    default:
+      return false;
+    }
+  }
+  if(optind != argc - 1) {
+    return false;
+  }
+  opt->path = argv[optind];
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if(!parse_options(argc, argv, &opt)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  int fd = open(opt.path, O_RDONLY);
+  struct stat st;
+  if(fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "Error: cannot open %s: %s\n", opt.path, strerror(errno));
+    return 1;
+  }
+  size_t size = st.st_size;
+  const char *data = nullptr;
+  if(size > 0) {
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED) {
+      fprintf(stderr, "Error: cannot map %s: %s\n", opt.path, strerror(errno));
+      return 1;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    data = static_cast<const char *>(map);
+  }
+
+  unsigned threads = opt.threads > 0 ? opt.threads : std::thread::hardware_concurrency();
+  threads = std::max(1u, threads);
+  if(size / threads < (1 << 20)) {
+    /* Not worth more than a thread per MiB */
+    threads = std::max<size_t>(1, size >> 20);
+  }
+
+  /* Cut the chunks just after a newline */
+  std::vector<const char *> bounds{data};
+  for(unsigned i = 1; i < threads; i++) {
+    const char *at = data + size * i / threads;
+    if(at < bounds.back()) {
+      continue;
+    }
+    const char *eol = static_cast<const char *>(memchr(at, '\n', data + size - at));
+    if(eol == nullptr) {
+      break;
+    }
+    bounds.push_back(eol + 1);
+  }
+  bounds.push_back(data + size);
+
+  std::vector<Chunk> chunks(bounds.size() - 1);
+  std::vector<std::thread> workers;
+  for(size_t i = 0; i < chunks.size(); i++) {
+    workers.emplace_back(parse_chunk, bounds[i], bounds[i + 1], &chunks[i]);
+  }
+  for(std::thread &t : workers) {
+    t.join();
+  }
+
+  FILE *csv = nullptr;
+  if(opt.csv_path != nullptr) {
+    if((csv = fopen(opt.csv_path, "w")) == nullptr) {
+      fprintf(stderr, "Error: cannot write %s: %s\n", opt.csv_path, strerror(errno));
+      return 1;
+    }
+    fprintf(csv, "time_s,node,tx,rx,prr,rssi,rtt_ms,ping_sent,pong_received,interval_loss\n");
+  }
+
+  std::map<uint32_t, NodeStats> nodes;
+  aggregate(chunks, opt, csv, &nodes);
+  print_summary(&nodes);
+
+  if(csv != nullptr) {
+    fclose(csv);
+  }
+  return 0;
+}
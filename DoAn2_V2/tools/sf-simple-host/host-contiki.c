@@ -0,0 +1,1001 @@
+/*
+ * Host build of sf-simple: in-memory TSCH schedule and 6P layer, see
+ * host-contiki.h.
+ */
+
+#include "host-contiki.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int host_verbose;
+unsigned long host_output_count;
+struct host_frame host_last_output;
+
+const linkaddr_t host_peers[HOST_NUM_PEERS] = {
+  { { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x02 } },
+  { { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x03 } },
+  { { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x04 } },
+  { { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x05 } },
+};
+
+linkaddr_t linkaddr_node_addr =
+  { { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+const linkaddr_t linkaddr_null;
+const linkaddr_t tsch_broadcast_address =
+  { { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff } };
+int tsch_is_associated = 1;
+struct tsch_asn_t tsch_current_asn;
+
+static const sixtop_sf_t *host_sf;
+/*---------------------------------------------------------------------------*/
+int
+host_printf(const char *fmt, ...)
+{
+  va_list ap;
+  int ret;
+
+  if(!host_verbose) {
+    return 0;
+  }
+  va_start(ap, fmt);
+  ret = vprintf(fmt, ap);
+  va_end(ap);
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+/* Bulk traffic: every frame sf-simple is asked about may be pinned */
+int
+traffic_class_callback_pin_packet(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t random_state = 1;
+
+void
+random_init(unsigned short seed)
+{
+  random_state = seed;
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+random_rand(void)
+{
+  /* linear congruential: a run repeats for a given seed */
+  random_state = random_state * 1103515245UL + 12345;
+  return (random_state >> 16) & RANDOM_RAND_MAX;
+}
+/*---------------------------------------------------------------------------*/
+static struct ctimer *timers[HOST_MAX_TIMERS];
+static int num_timers;
+
+void
+ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr)
+{
+  int i;
+
+  c->f = f;
+  c->ptr = ptr;
+  c->interval = t;
+  c->active = 1;
+  for(i = 0; i < num_timers; i++) {
+    if(timers[i] == c) {
+      return;
+    }
+  }
+  assert(num_timers < HOST_MAX_TIMERS);
+  timers[num_timers++] = c;
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_reset(struct ctimer *c)
+{
+  c->active = 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_stop(struct ctimer *c)
+{
+  c->active = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+ctimer_expired(struct ctimer *c)
+{
+  return !c->active;
+}
+/*---------------------------------------------------------------------------*/
+void
+host_fire_timers(void)
+{
+  int n = num_timers;
+  int i;
+
+  /* timers set by the callbacks wait for the next round */
+  for(i = 0; i < n; i++) {
+    if(timers[i]->active) {
+      timers[i]->active = 0;
+      timers[i]->f(timers[i]->ptr);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct list {
+  struct list *next;
+};
+
+void
+list_init(list_t list)
+{
+  *list = NULL;
+}
+/*---------------------------------------------------------------------------*/
+void *
+list_head(list_t list)
+{
+  return *list;
+}
+/*---------------------------------------------------------------------------*/
+void
+list_remove(list_t list, const void *item)
+{
+  struct list **l;
+
+  for(l = (struct list **)list; *l != NULL; l = &(*l)->next) {
+    if(*l == item) {
+      *l = (*l)->next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+list_add(list_t list, void *item)
+{
+  struct list **l;
+
+  /* an item is at most once in a list */
+  list_remove(list, item);
+  ((struct list *)item)->next = NULL;
+  for(l = (struct list **)list; *l != NULL; l = &(*l)->next);
+  *l = item;
+}
+/*---------------------------------------------------------------------------*/
+void *
+list_item_next(const void *item)
+{
+  return item == NULL ? NULL : ((const struct list *)item)->next;
+}
+/*---------------------------------------------------------------------------*/
+int
+list_length(list_t list)
+{
+  struct list *l;
+  int n = 0;
+
+  for(l = *list; l != NULL; l = l->next) {
+    n++;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+void
+memb_init(struct memb *m)
+{
+  memset(m->count, 0, m->num);
+  memset(m->mem, 0, (size_t)m->size * m->num);
+}
+/*---------------------------------------------------------------------------*/
+void *
+memb_alloc(struct memb *m)
+{
+  int i;
+
+  for(i = 0; i < m->num; i++) {
+    if(m->count[i] == 0) {
+      m->count[i]++;
+      return (char *)m->mem + (size_t)i * m->size;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+memb_free(struct memb *m, void *ptr)
+{
+  char *p = (char *)ptr;
+  int i;
+
+  for(i = 0; i < m->num; i++) {
+    if(p == (char *)m->mem + (size_t)i * m->size) {
+      /* freeing twice is a bug of the caller */
+      assert(m->count[i] > 0);
+      return --m->count[i];
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+memb_numfree(struct memb *m)
+{
+  int i;
+  int n = 0;
+
+  for(i = 0; i < m->num; i++) {
+    n += m->count[i] == 0;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+int
+linkaddr_cmp(const linkaddr_t *addr1, const linkaddr_t *addr2)
+{
+  return memcmp(addr1, addr2, LINKADDR_SIZE) == 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+linkaddr_copy(linkaddr_t *dest, const linkaddr_t *from)
+{
+  memcpy(dest, from, LINKADDR_SIZE);
+}
+/*---------------------------------------------------------------------------*/
+static packetbuf_attr_t packetbuf_attrs[PACKETBUF_NUM_ATTRS];
+static linkaddr_t packetbuf_addrs[PACKETBUF_NUM_ADDRS];
+
+packetbuf_attr_t
+packetbuf_attr(uint8_t type)
+{
+  return type < PACKETBUF_NUM_ATTRS ? packetbuf_attrs[type] : 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val)
+{
+  if(type < PACKETBUF_NUM_ATTRS) {
+    packetbuf_attrs[type] = val;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+const linkaddr_t *
+packetbuf_addr(uint8_t type)
+{
+  return type < PACKETBUF_NUM_ADDRS ? &packetbuf_addrs[type] : &linkaddr_null;
+}
+/*---------------------------------------------------------------------------*/
+int
+packetbuf_set_addr(uint8_t type, const linkaddr_t *addr)
+{
+  if(type < PACKETBUF_NUM_ADDRS) {
+    linkaddr_copy(&packetbuf_addrs[type], addr);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static struct netstack_sniffer *sniffers;
+
+void
+netstack_sniffer_add(struct netstack_sniffer *s)
+{
+  struct netstack_sniffer *n;
+
+  for(n = sniffers; n != NULL; n = n->next) {
+    if(n == s) {
+      return;
+    }
+  }
+  s->next = sniffers;
+  sniffers = s;
+}
+/*---------------------------------------------------------------------------*/
+void
+host_sniff(const linkaddr_t *peer_addr, uint16_t slotframe,
+           uint16_t timeslot, int mac_status)
+{
+  struct netstack_sniffer *s;
+
+  memset(packetbuf_attrs, 0, sizeof(packetbuf_attrs));
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, peer_addr);
+  packetbuf_set_attr(PACKETBUF_ATTR_TSCH_SLOTFRAME, slotframe);
+  packetbuf_set_attr(PACKETBUF_ATTR_TSCH_TIMESLOT, timeslot);
+  for(s = sniffers; s != NULL; s = s->next) {
+    if(s->output_callback != NULL) {
+      s->output_callback(mac_status);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+host_receive(const linkaddr_t *peer_addr)
+{
+  struct netstack_sniffer *s;
+
+  memset(packetbuf_attrs, 0, sizeof(packetbuf_attrs));
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, peer_addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  for(s = sniffers; s != NULL; s = s->next) {
+    if(s->input_callback != NULL) {
+      s->input_callback();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+MEMB(link_memb, struct tsch_link, HOST_MAX_LINKS);
+MEMB(slotframe_memb, struct tsch_slotframe, HOST_MAX_SLOTFRAMES);
+LIST(slotframe_list);
+static uint16_t next_link_handle;
+
+struct tsch_slotframe *
+tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
+{
+  struct tsch_slotframe *sf;
+
+  if(size == 0 || tsch_schedule_get_slotframe_by_handle(handle) != NULL ||
+     (sf = memb_alloc(&slotframe_memb)) == NULL) {
+    return NULL;
+  }
+  sf->handle = handle;
+  sf->size.val = size;
+  sf->size.inv = 0;
+  LIST_STRUCT_INIT(sf, links_list);
+  list_add(slotframe_list, sf);
+  return sf;
+}
+/*---------------------------------------------------------------------------*/
+struct tsch_slotframe *
+tsch_schedule_get_slotframe_by_handle(uint16_t handle)
+{
+  struct tsch_slotframe *sf;
+
+  for(sf = list_head(slotframe_list); sf != NULL; sf = list_item_next(sf)) {
+    if(sf->handle == handle) {
+      return sf;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe)
+{
+  struct tsch_link *l;
+
+  if(slotframe == NULL) {
+    return 0;
+  }
+  while((l = list_head(slotframe->links_list)) != NULL) {
+    tsch_schedule_remove_link(slotframe, l);
+  }
+  list_remove(slotframe_list, slotframe);
+  memb_free(&slotframe_memb, slotframe);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+struct tsch_link *
+tsch_schedule_add_link(struct tsch_slotframe *slotframe,
+                       uint8_t link_options, enum link_type link_type,
+                       const linkaddr_t *address,
+                       uint16_t timeslot, uint16_t channel_offset,
+                       uint8_t do_remove)
+{
+  struct tsch_link *l;
+
+  if(slotframe == NULL) {
+    return NULL;
+  }
+  if(do_remove) {
+    /* as TSCH: the link at these offsets, if any, is replaced */
+    tsch_schedule_remove_link_by_offsets(slotframe, timeslot, channel_offset);
+  }
+  if((l = memb_alloc(&link_memb)) == NULL) {
+    return NULL;
+  }
+  l->handle = next_link_handle++;
+  linkaddr_copy(&l->addr, address != NULL ? address : &linkaddr_null);
+  l->slotframe_handle = slotframe->handle;
+  l->timeslot = timeslot;
+  l->channel_offset = channel_offset;
+  l->link_options = link_options;
+  l->link_type = link_type;
+  l->data = NULL;
+  list_add(slotframe->links_list, l);
+  return l;
+}
+/*---------------------------------------------------------------------------*/
+struct tsch_link *
+tsch_schedule_get_link_by_offsets(struct tsch_slotframe *slotframe,
+                                  uint16_t timeslot, uint16_t channel_offset)
+{
+  struct tsch_link *l;
+
+  if(slotframe == NULL) {
+    return NULL;
+  }
+  for(l = list_head(slotframe->links_list); l != NULL; l = list_item_next(l)) {
+    if(l->timeslot == timeslot && l->channel_offset == channel_offset) {
+      return l;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_schedule_remove_link(struct tsch_slotframe *slotframe,
+                          struct tsch_link *l)
+{
+  if(slotframe == NULL || l == NULL ||
+     l->slotframe_handle != slotframe->handle) {
+    return 0;
+  }
+  list_remove(slotframe->links_list, l);
+  memb_free(&link_memb, l);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_schedule_remove_link_by_offsets(struct tsch_slotframe *slotframe,
+                                     uint16_t timeslot,
+                                     uint16_t channel_offset)
+{
+  return tsch_schedule_remove_link(slotframe,
+                                   tsch_schedule_get_link_by_offsets(slotframe,
+                                                                     timeslot,
+                                                                     channel_offset));
+}
+/*---------------------------------------------------------------------------*/
+static struct tsch_neighbor neighbors[HOST_NUM_PEERS];
+
+struct tsch_neighbor *
+tsch_queue_get_time_source(void)
+{
+  return &neighbors[0];
+}
+/*---------------------------------------------------------------------------*/
+struct tsch_neighbor *
+tsch_queue_get_nbr(const linkaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < HOST_NUM_PEERS; i++) {
+    if(linkaddr_cmp(&neighbors[i].addr, addr)) {
+      return &neighbors[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_queue_nbr_packet_count(const struct tsch_neighbor *n)
+{
+  return n == NULL ? -1 : n->packet_count;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_queue_free_packets_to(const linkaddr_t *addr)
+{
+  struct tsch_neighbor *n = tsch_queue_get_nbr(addr);
+  int count;
+
+  if(n == NULL) {
+    return 0;
+  }
+  count = n->packet_count;
+  n->packet_count = 0;
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+void
+host_set_queue(const linkaddr_t *peer_addr, int packet_count)
+{
+  struct tsch_neighbor *n = tsch_queue_get_nbr(peer_addr);
+
+  if(n != NULL) {
+    n->packet_count = packet_count;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * 6P bodies, RFC 8480 section 3.3:
+ *   ADD, DELETE request   Metadata(2) CellOptions(1) NumCells(1) CellList
+ *   RELOCATE request      Metadata(2) CellOptions(1) NumCells(1)
+ *                         RelCellList(NumCells cells) CandCellList
+ *   COUNT request         Metadata(2) CellOptions(1)
+ *   LIST request          Metadata(2) CellOptions(1) Reserved(1)
+ *                         Offset(2) MaxNumCells(2)
+ *   CLEAR, SIGNAL request Metadata(2) ...
+ *   SUCCESS/EOL response  CellList, or TotalNumCells(2) to a COUNT
+ * Fields are in host byte order, as Contiki's sixp-pkt.c copies them. A
+ * cell takes 4 bytes.
+ */
+#define CELL_LEN 4
+
+static int
+is_request(sixp_pkt_type_t type, sixp_pkt_code_t code)
+{
+  return type == SIXP_PKT_TYPE_REQUEST &&
+    code.value >= SIXP_PKT_CMD_ADD && code.value <= SIXP_PKT_CMD_CLEAR;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_success(sixp_pkt_type_t type, sixp_pkt_code_t code)
+{
+  return (type == SIXP_PKT_TYPE_RESPONSE ||
+          type == SIXP_PKT_TYPE_CONFIRMATION) &&
+    (code.value == SIXP_PKT_RC_SUCCESS || code.value == SIXP_PKT_RC_EOL);
+}
+/*---------------------------------------------------------------------------*/
+enum {
+  METADATA_FIELD,
+  CELL_OPTIONS_FIELD,
+  NUM_CELLS_FIELD,
+  RESERVED_FIELD,
+  OFFSET_FIELD,
+  MAX_NUM_CELLS_FIELD,
+  CELL_LIST_FIELD,
+  REL_CELL_LIST_FIELD,
+  TOTAL_NUM_CELLS_FIELD,
+};
+
+static int32_t
+field_offset(sixp_pkt_type_t type, sixp_pkt_code_t code, int field)
+{
+  if(is_request(type, code)) {
+    switch(field) {
+    case METADATA_FIELD:
+      return 0;
+    case CELL_OPTIONS_FIELD:
+      return code.value <= SIXP_PKT_CMD_LIST ? 2 : -1;
+    case NUM_CELLS_FIELD:
+    case REL_CELL_LIST_FIELD:
+      if(code.value == SIXP_PKT_CMD_ADD || code.value == SIXP_PKT_CMD_DELETE ||
+         code.value == SIXP_PKT_CMD_RELOCATE) {
+        return field == NUM_CELLS_FIELD ? 3 : 4;
+      }
+      return -1;
+    case CELL_LIST_FIELD:
+      return (code.value == SIXP_PKT_CMD_ADD ||
+              code.value == SIXP_PKT_CMD_DELETE) ? 4 : -1;
+    case RESERVED_FIELD:
+      return code.value == SIXP_PKT_CMD_LIST ? 3 : -1;
+    case OFFSET_FIELD:
+      return code.value == SIXP_PKT_CMD_LIST ? 4 : -1;
+    case MAX_NUM_CELLS_FIELD:
+      return code.value == SIXP_PKT_CMD_LIST ? 6 : -1;
+    }
+  } else if(is_success(type, code)) {
+    if(field == CELL_LIST_FIELD || field == TOTAL_NUM_CELLS_FIELD) {
+      return 0;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+get_field(int32_t offset, void *value, size_t len,
+          const uint8_t *body, uint16_t body_len)
+{
+  if(value == NULL || body == NULL || offset < 0 ||
+     (size_t)offset + len > body_len) {
+    return -1;
+  }
+  memcpy(value, body + offset, len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_field(int32_t offset, const void *value, size_t len,
+          uint8_t *body, uint16_t body_len)
+{
+  if(value == NULL || body == NULL || offset < 0 ||
+     (size_t)offset + len > body_len) {
+    return -1;
+  }
+  memcpy(body + offset, value, len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#define FIELD_ACCESSORS(name, field, ctype) \
+  int \
+  sixp_pkt_set_##name(sixp_pkt_type_t type, sixp_pkt_code_t code, \
+                      ctype value, uint8_t *body, uint16_t body_len) \
+  { \
+    return set_field(field_offset(type, code, field), &value, sizeof(value), \
+                     body, body_len); \
+  } \
+  int \
+  sixp_pkt_get_##name(sixp_pkt_type_t type, sixp_pkt_code_t code, \
+                      ctype *value, const uint8_t *body, uint16_t body_len) \
+  { \
+    return get_field(field_offset(type, code, field), value, sizeof(*value), \
+                     body, body_len); \
+  }
+
+FIELD_ACCESSORS(metadata, METADATA_FIELD, sixp_pkt_metadata_t)
+FIELD_ACCESSORS(cell_options, CELL_OPTIONS_FIELD, sixp_pkt_cell_options_t)
+FIELD_ACCESSORS(num_cells, NUM_CELLS_FIELD, sixp_pkt_num_cells_t)
+FIELD_ACCESSORS(offset, OFFSET_FIELD, sixp_pkt_offset_t)
+FIELD_ACCESSORS(max_num_cells, MAX_NUM_CELLS_FIELD, sixp_pkt_max_num_cells_t)
+FIELD_ACCESSORS(total_num_cells, TOTAL_NUM_CELLS_FIELD,
+                sixp_pkt_total_num_cells_t)
+
+int
+sixp_pkt_set_reserved(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                      sixp_pkt_reserved_t reserved,
+                      uint8_t *body, uint16_t body_len)
+{
+  return set_field(field_offset(type, code, RESERVED_FIELD),
+                   &reserved, sizeof(reserved), body, body_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_cells(int32_t offset, const uint8_t *cells, uint16_t cells_len,
+          uint16_t cell_offset, uint8_t *body, uint16_t body_len)
+{
+  if(cells == NULL || offset < 0 || (cells_len % CELL_LEN) != 0) {
+    return -1;
+  }
+  return set_field(offset + cell_offset, cells, cells_len, body, body_len);
+}
+/*---------------------------------------------------------------------------*/
+/* Cells from offset to the end of the body, a whole number of them */
+static int
+get_cells(int32_t offset, const uint8_t **cells, sixp_pkt_offset_t *cells_len,
+          const uint8_t *body, uint16_t body_len)
+{
+  if(cells == NULL || cells_len == NULL || body == NULL || offset < 0 ||
+     offset > body_len || ((body_len - offset) % CELL_LEN) != 0) {
+    return -1;
+  }
+  *cells = body + offset;
+  *cells_len = body_len - offset;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+sixp_pkt_set_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                       const uint8_t *cell_list, uint16_t cell_list_len,
+                       uint16_t cell_offset,
+                       uint8_t *body, uint16_t body_len)
+{
+  return set_cells(field_offset(type, code, CELL_LIST_FIELD),
+                   cell_list, cell_list_len, cell_offset, body, body_len);
+}
+/*---------------------------------------------------------------------------*/
+int
+sixp_pkt_get_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                       const uint8_t **cell_list,
+                       sixp_pkt_offset_t *cell_list_len,
+                       const uint8_t *body, uint16_t body_len)
+{
+  return get_cells(field_offset(type, code, CELL_LIST_FIELD),
+                   cell_list, cell_list_len, body, body_len);
+}
+/*---------------------------------------------------------------------------*/
+int
+sixp_pkt_set_rel_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                           const uint8_t *rel_cell_list,
+                           uint16_t rel_cell_list_len, uint16_t cell_offset,
+                           uint8_t *body, uint16_t body_len)
+{
+  if(code.value != SIXP_PKT_CMD_RELOCATE) {
+    return -1;
+  }
+  return set_cells(field_offset(type, code, REL_CELL_LIST_FIELD),
+                   rel_cell_list, rel_cell_list_len, cell_offset,
+                   body, body_len);
+}
+/*---------------------------------------------------------------------------*/
+int
+sixp_pkt_get_rel_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                           const uint8_t **rel_cell_list,
+                           sixp_pkt_offset_t *rel_cell_list_len,
+                           const uint8_t *body, uint16_t body_len)
+{
+  int32_t offset = field_offset(type, code, REL_CELL_LIST_FIELD);
+  sixp_pkt_num_cells_t num_cells;
+
+  /* NumCells cells, then the candidates */
+  if(code.value != SIXP_PKT_CMD_RELOCATE || rel_cell_list == NULL ||
+     rel_cell_list_len == NULL ||
+     sixp_pkt_get_num_cells(type, code, &num_cells, body, body_len) != 0 ||
+     offset + num_cells * CELL_LEN > body_len) {
+    return -1;
+  }
+  *rel_cell_list = body + offset;
+  *rel_cell_list_len = num_cells * CELL_LEN;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+sixp_pkt_set_cand_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                            const uint8_t *cand_cell_list,
+                            uint16_t cand_cell_list_len, uint16_t cell_offset,
+                            uint8_t *body, uint16_t body_len)
+{
+  sixp_pkt_num_cells_t num_cells;
+
+  if(code.value != SIXP_PKT_CMD_RELOCATE ||
+     sixp_pkt_get_num_cells(type, code, &num_cells, body, body_len) != 0) {
+    return -1;
+  }
+  return set_cells(field_offset(type, code, REL_CELL_LIST_FIELD) +
+                   num_cells * CELL_LEN,
+                   cand_cell_list, cand_cell_list_len, cell_offset,
+                   body, body_len);
+}
+/*---------------------------------------------------------------------------*/
+int
+sixp_pkt_get_cand_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                            const uint8_t **cand_cell_list,
+                            sixp_pkt_offset_t *cand_cell_list_len,
+                            const uint8_t *body, uint16_t body_len)
+{
+  sixp_pkt_num_cells_t num_cells;
+
+  if(code.value != SIXP_PKT_CMD_RELOCATE ||
+     sixp_pkt_get_num_cells(type, code, &num_cells, body, body_len) != 0) {
+    return -1;
+  }
+  return get_cells(field_offset(type, code, REL_CELL_LIST_FIELD) +
+                   num_cells * CELL_LEN,
+                   cand_cell_list, cand_cell_list_len, body, body_len);
+}
+/*---------------------------------------------------------------------------*/
+/* One transaction per peer, as in 6P */
+struct sixp_trans {
+  linkaddr_t peer_addr;
+  sixp_pkt_cmd_t cmd;
+  uint8_t in_use;
+  uint8_t initiator;    /* we sent the request */
+  uint8_t sending;      /* a frame is out, its callback not called yet */
+  sixp_sent_callback_t func;
+  void *arg;
+  uint16_t arg_len;
+};
+
+static struct sixp_trans transactions[HOST_MAX_TRANSACTIONS];
+static int sixp_nbr_dummy;
+
+sixp_nbr_t *
+sixp_nbr_find(const linkaddr_t *addr)
+{
+  return addr == NULL ? NULL : (sixp_nbr_t *)&sixp_nbr_dummy;
+}
+/*---------------------------------------------------------------------------*/
+sixp_trans_t *
+sixp_trans_find(const linkaddr_t *peer_addr)
+{
+  int i;
+
+  for(i = 0; i < HOST_MAX_TRANSACTIONS; i++) {
+    if(transactions[i].in_use &&
+       linkaddr_cmp(&transactions[i].peer_addr, peer_addr)) {
+      return &transactions[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+sixp_pkt_cmd_t
+sixp_trans_get_cmd(sixp_trans_t *trans)
+{
+  return trans == NULL ? SIXP_PKT_CMD_UNAVAILABLE : trans->cmd;
+}
+/*---------------------------------------------------------------------------*/
+static sixp_trans_t *
+trans_alloc(const linkaddr_t *peer_addr, sixp_pkt_cmd_t cmd, int initiator)
+{
+  int i;
+
+  if(sixp_trans_find(peer_addr) != NULL) {
+    return NULL;
+  }
+  for(i = 0; i < HOST_MAX_TRANSACTIONS; i++) {
+    if(!transactions[i].in_use) {
+      memset(&transactions[i], 0, sizeof(transactions[i]));
+      linkaddr_copy(&transactions[i].peer_addr, peer_addr);
+      transactions[i].cmd = cmd;
+      transactions[i].initiator = initiator;
+      transactions[i].in_use = 1;
+      return &transactions[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+sixp_output(sixp_pkt_type_t type, sixp_pkt_code_t code, uint8_t sfid,
+            const uint8_t *body, uint16_t body_len,
+            const linkaddr_t *dest_addr,
+            sixp_sent_callback_t func, void *arg, uint16_t arg_len)
+{
+  sixp_trans_t *trans;
+
+  assert(dest_addr != NULL && (body != NULL || body_len == 0));
+
+  if(type == SIXP_PKT_TYPE_REQUEST) {
+    /* a new transaction, refused while one runs with the peer */
+    if((trans = trans_alloc(dest_addr, code.cmd, 1)) == NULL) {
+      return -1;
+    }
+  } else if(type == SIXP_PKT_TYPE_RESPONSE) {
+    /* answers the request the transaction was opened with, once */
+    if((trans = sixp_trans_find(dest_addr)) == NULL || trans->initiator ||
+       trans->sending || trans->func != NULL) {
+      return -1;
+    }
+  } else {
+    return -1;
+  }
+
+  trans->sending = 1;
+  trans->func = func;
+  trans->arg = arg;
+  trans->arg_len = arg_len;
+  host_output_count++;
+  host_last_output.type = type;
+  host_last_output.code = code;
+  linkaddr_copy(&host_last_output.dest_addr, dest_addr);
+  host_last_output.body_len = MIN(body_len, HOST_MAX_BODY);
+  if(body_len > 0) {
+    memcpy(host_last_output.body, body, host_last_output.body_len);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+trans_free(sixp_trans_t *trans)
+{
+  if(trans != NULL) {
+    trans->in_use = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+host_request(const linkaddr_t *peer_addr, sixp_pkt_cmd_t cmd,
+             const uint8_t *body, uint16_t body_len)
+{
+  sixp_trans_t *trans;
+  uint8_t *copy;
+
+  if((trans = trans_alloc(peer_addr, cmd, 0)) == NULL) {
+    return -1;
+  }
+
+  /* a buffer of the exact size, for the sanitizers to catch overreads */
+  copy = malloc(body_len > 0 ? body_len : 1);
+  assert(copy != NULL);
+  memcpy(copy, body, body_len);
+  host_sf->input(SIXP_PKT_TYPE_REQUEST, (sixp_pkt_code_t)(uint8_t)cmd,
+                 copy, body_len, peer_addr);
+  free(copy);
+
+  if(!trans->sending) {
+    /* not answered: 6P would let the transaction time out */
+    trans_free(trans);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+host_response(const linkaddr_t *peer_addr, sixp_pkt_rc_t rc,
+              const uint8_t *body, uint16_t body_len)
+{
+  sixp_trans_t *trans = sixp_trans_find(peer_addr);
+  uint8_t *copy;
+
+  if(trans == NULL || !trans->initiator) {
+    return -1;
+  }
+  if(trans->sending) {
+    /* the request went out */
+    host_complete(peer_addr, SIXP_OUTPUT_STATUS_SUCCESS);
+  }
+
+  copy = malloc(body_len > 0 ? body_len : 1);
+  assert(copy != NULL);
+  memcpy(copy, body, body_len);
+  host_sf->input(SIXP_PKT_TYPE_RESPONSE, (sixp_pkt_code_t)(uint8_t)rc,
+                 copy, body_len, peer_addr);
+  free(copy);
+
+  /* two-step transactions end with the response */
+  trans_free(sixp_trans_find(peer_addr));
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+host_complete(const linkaddr_t *peer_addr, sixp_output_status_t status)
+{
+  sixp_trans_t *trans = sixp_trans_find(peer_addr);
+  sixp_sent_callback_t func;
+  void *arg;
+  uint16_t arg_len;
+  linkaddr_t dest;
+
+  if(trans == NULL || !trans->sending) {
+    return -1;
+  }
+
+  func = trans->func;
+  arg = trans->arg;
+  arg_len = trans->arg_len;
+  trans->sending = 0;
+  trans->func = NULL;
+  linkaddr_copy(&dest, &trans->peer_addr);
+  if(!trans->initiator || status != SIXP_OUTPUT_STATUS_SUCCESS) {
+    /* our response is out, or the frame is lost: the transaction ends */
+    trans_free(trans);
+  }
+  if(func != NULL) {
+    func(arg, arg_len, &dest, status);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+host_timeout(const linkaddr_t *peer_addr)
+{
+  sixp_trans_t *trans = sixp_trans_find(peer_addr);
+  linkaddr_t peer;
+
+  if(trans == NULL) {
+    return -1;
+  }
+  /* the sent callback of a frame still out is never called */
+  linkaddr_copy(&peer, peer_addr);
+  host_sf->timeout(trans->cmd, &peer);
+  trans_free(trans);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+host_error(const linkaddr_t *peer_addr, sixp_error_t err)
+{
+  sixp_trans_t *trans = sixp_trans_find(peer_addr);
+  linkaddr_t peer;
+
+  linkaddr_copy(&peer, peer_addr);
+  host_sf->error(err, sixp_trans_get_cmd(trans), 0, &peer);
+  trans_free(trans);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+host_reset(const sixtop_sf_t *sf, unsigned short seed)
+{
+  struct tsch_slotframe *slotframe;
+  int i;
+
+  while((slotframe = list_head(slotframe_list)) != NULL) {
+    tsch_schedule_remove_slotframe(slotframe);
+  }
+  memb_init(&link_memb);
+  memb_init(&slotframe_memb);
+  list_init(slotframe_list);
+  next_link_handle = 0;
+
+  memset(transactions, 0, sizeof(transactions));
+  memset(timers, 0, sizeof(timers));
+  num_timers = 0;
+  sniffers = NULL;
+  memset(packetbuf_attrs, 0, sizeof(packetbuf_attrs));
+  memset(packetbuf_addrs, 0, sizeof(packetbuf_addrs));
+  memset(neighbors, 0, sizeof(neighbors));
+  for(i = 0; i < HOST_NUM_PEERS; i++) {
+    linkaddr_copy(&neighbors[i].addr, &host_peers[i]);
+  }
+  neighbors[0].is_time_source = 1;
+  tsch_is_associated = 1;
+  memset(&tsch_current_asn, 0, sizeof(tsch_current_asn));
+  host_output_count = 0;
+  memset(&host_last_output, 0, sizeof(host_last_output));
+  random_init(seed);
+
+  host_sf = sf;
+  sf->init();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,465 @@
+/*
+ * Host build of sf-simple: the part of Contiki-NG, TSCH and 6top that
+ * sf-simple.c relies on, reduced to an in-memory schedule, an in-memory
+ * 6P transaction table and the 6P packet layouts of RFC 8480. The stub
+ * headers under include/ all come down to this file, so that sf-simple.c
+ * compiles unchanged with the native compiler.
+ *
+ * The harness functions (host_*) play the part of the 6P layer and of the
+ * TSCH scheduler: they deliver requests and responses to the scheduling
+ * function, complete the frames it sends and fire its timers.
+ */
+
+#ifndef HOST_CONTIKI_H_
+#define HOST_CONTIKI_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Same configuration as the firmware */
+#include "project-conf.h"
+
+/*---------------------------------------------------------------------------*/
+/* Contiki core */
+#ifndef MIN
+#define MIN(n, m) (((n) < (m)) ? (n) : (m))
+#endif
+#ifndef MAX
+#define MAX(n, m) (((n) < (m)) ? (m) : (n))
+#endif
+
+typedef uint32_t clock_time_t;
+#define CLOCK_SECOND 128
+
+struct ctimer {
+  void (*f)(void *);
+  void *ptr;
+  clock_time_t interval;
+  uint8_t active;
+};
+
+void ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr);
+void ctimer_reset(struct ctimer *c);
+void ctimer_stop(struct ctimer *c);
+int ctimer_expired(struct ctimer *c);
+
+#define RANDOM_RAND_MAX 65535U
+unsigned short random_rand(void);
+void random_init(unsigned short seed);
+
+typedef void **list_t;
+#define LIST(name) \
+  static void *name##_list = NULL; \
+  static list_t name = (list_t)&name##_list
+#define LIST_STRUCT(name) \
+  void *name##_list; \
+  list_t name
+#define LIST_STRUCT_INIT(struct_ptr, name) \
+  do { \
+    (struct_ptr)->name = &((struct_ptr)->name##_list); \
+    (struct_ptr)->name##_list = NULL; \
+  } while(0)
+
+void list_init(list_t list);
+void *list_head(list_t list);
+void list_add(list_t list, void *item);
+void list_remove(list_t list, const void *item);
+void *list_item_next(const void *item);
+int list_length(list_t list);
+
+struct memb {
+  unsigned short size;
+  unsigned short num;
+  char *count;
+  void *mem;
+};
+#define MEMB(name, structure, num) \
+  static char name##_memb_count[num]; \
+  static structure name##_memb_mem[num]; \
+  static struct memb name = { sizeof(structure), num, \
+                              name##_memb_count, (void *)name##_memb_mem }
+
+void memb_init(struct memb *m);
+void *memb_alloc(struct memb *m);
+int memb_free(struct memb *m, void *ptr);
+int memb_numfree(struct memb *m);
+
+/*---------------------------------------------------------------------------*/
+/* Link-layer addresses, packetbuf, netstack */
+#define LINKADDR_SIZE 8
+typedef union {
+  unsigned char u8[LINKADDR_SIZE];
+  uint16_t u16[LINKADDR_SIZE / 2];
+} linkaddr_t;
+
+extern linkaddr_t linkaddr_node_addr;
+extern const linkaddr_t linkaddr_null;
+int linkaddr_cmp(const linkaddr_t *addr1, const linkaddr_t *addr2);
+void linkaddr_copy(linkaddr_t *dest, const linkaddr_t *from);
+
+typedef struct { uint8_t addr[LINKADDR_SIZE]; } uip_lladdr_t;
+
+enum {
+  PACKETBUF_ATTR_NONE,
+  PACKETBUF_ATTR_MAC_METADATA,
+  PACKETBUF_ATTR_TSCH_SLOTFRAME,
+  PACKETBUF_ATTR_TSCH_TIMESLOT,
+  PACKETBUF_ATTR_TSCH_CHANNEL_OFFSET,
+  PACKETBUF_NUM_ATTRS
+};
+enum {
+  PACKETBUF_ADDR_SENDER,
+  PACKETBUF_ADDR_RECEIVER,
+  PACKETBUF_NUM_ADDRS
+};
+typedef uint16_t packetbuf_attr_t;
+
+packetbuf_attr_t packetbuf_attr(uint8_t type);
+int packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val);
+const linkaddr_t *packetbuf_addr(uint8_t type);
+int packetbuf_set_addr(uint8_t type, const linkaddr_t *addr);
+
+enum {
+  MAC_TX_OK,
+  MAC_TX_COLLISION,
+  MAC_TX_NOACK,
+  MAC_TX_DEFERRED,
+  MAC_TX_ERR,
+  MAC_TX_ERR_FATAL,
+  MAC_TX_QUEUE_FULL,
+};
+
+struct netstack_sniffer {
+  struct netstack_sniffer *next;
+  void (*input_callback)(void);
+  void (*output_callback)(int mac_status);
+};
+#define NETSTACK_SNIFFER(name, input_callback, output_callback) \
+  static struct netstack_sniffer name = { NULL, input_callback, output_callback }
+void netstack_sniffer_add(struct netstack_sniffer *s);
+
+/*---------------------------------------------------------------------------*/
+/* TSCH */
+#ifdef TSCH_CONF_WITH_LINK_SELECTOR
+#define TSCH_WITH_LINK_SELECTOR TSCH_CONF_WITH_LINK_SELECTOR
+#else
+#define TSCH_WITH_LINK_SELECTOR 0
+#endif
+#ifdef TSCH_CONF_DEFAULT_TIMESLOT_LENGTH
+#define TSCH_DEFAULT_TIMESLOT_LENGTH TSCH_CONF_DEFAULT_TIMESLOT_LENGTH
+#else
+#define TSCH_DEFAULT_TIMESLOT_LENGTH 10000
+#endif
+#define TSCH_HOPPING_SEQUENCE_4_4 (uint8_t[]){ 15, 25, 26, 20 }
+#define TSCH_DEFAULT_HOPPING_SEQUENCE TSCH_HOPPING_SEQUENCE_4_4
+
+struct tsch_asn_divisor_t {
+  uint16_t val;
+  uint16_t inv;
+};
+
+enum link_type { LINK_TYPE_NORMAL, LINK_TYPE_ADVERTISING, LINK_TYPE_ADVERTISING_ONLY };
+
+#define LINK_OPTION_TX              1
+#define LINK_OPTION_RX              2
+#define LINK_OPTION_SHARED          4
+#define LINK_OPTION_TIME_KEEPING    8
+
+struct tsch_link {
+  struct tsch_link *next;
+  uint16_t handle;
+  linkaddr_t addr;
+  uint16_t slotframe_handle;
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  uint8_t link_options;
+  enum link_type link_type;
+  void *data;
+};
+
+struct tsch_slotframe {
+  struct tsch_slotframe *next;
+  uint16_t handle;
+  struct tsch_asn_divisor_t size;
+  LIST_STRUCT(links_list);
+};
+
+struct tsch_neighbor {
+  struct tsch_neighbor *next;
+  linkaddr_t addr;
+  uint8_t is_broadcast;
+  uint8_t is_time_source;
+  int packet_count;
+};
+
+struct tsch_asn_t {
+  uint32_t ls4b;
+  uint8_t ms1b;
+};
+
+extern int tsch_is_associated;
+extern struct tsch_asn_t tsch_current_asn;
+extern const linkaddr_t tsch_broadcast_address;
+
+struct tsch_slotframe *tsch_schedule_add_slotframe(uint16_t handle,
+                                                   uint16_t size);
+struct tsch_slotframe *tsch_schedule_get_slotframe_by_handle(uint16_t handle);
+int tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe);
+struct tsch_link *tsch_schedule_add_link(struct tsch_slotframe *slotframe,
+                                         uint8_t link_options,
+                                         enum link_type link_type,
+                                         const linkaddr_t *address,
+                                         uint16_t timeslot,
+                                         uint16_t channel_offset,
+                                         uint8_t do_remove);
+struct tsch_link *tsch_schedule_get_link_by_offsets(struct tsch_slotframe *slotframe,
+                                                    uint16_t timeslot,
+                                                    uint16_t channel_offset);
+int tsch_schedule_remove_link(struct tsch_slotframe *slotframe,
+                              struct tsch_link *l);
+int tsch_schedule_remove_link_by_offsets(struct tsch_slotframe *slotframe,
+                                         uint16_t timeslot,
+                                         uint16_t channel_offset);
+
+struct tsch_neighbor *tsch_queue_get_time_source(void);
+struct tsch_neighbor *tsch_queue_get_nbr(const linkaddr_t *addr);
+int tsch_queue_nbr_packet_count(const struct tsch_neighbor *n);
+int tsch_queue_free_packets_to(const linkaddr_t *addr);
+
+/*---------------------------------------------------------------------------*/
+/* 6top: packet */
+typedef enum {
+  SIXP_PKT_TYPE_REQUEST = 0x00,
+  SIXP_PKT_TYPE_RESPONSE = 0x01,
+  SIXP_PKT_TYPE_CONFIRMATION = 0x02,
+  SIXP_PKT_TYPE_RESERVED = 0x03,
+} sixp_pkt_type_t;
+
+typedef enum {
+  SIXP_PKT_CMD_ADD = 0x01,
+  SIXP_PKT_CMD_DELETE = 0x02,
+  SIXP_PKT_CMD_RELOCATE = 0x03,
+  SIXP_PKT_CMD_COUNT = 0x04,
+  SIXP_PKT_CMD_LIST = 0x05,
+  SIXP_PKT_CMD_SIGNAL = 0x06,
+  SIXP_PKT_CMD_CLEAR = 0x07,
+  SIXP_PKT_CMD_UNAVAILABLE = 0xff,
+} sixp_pkt_cmd_t;
+
+typedef enum {
+  SIXP_PKT_RC_SUCCESS = 0x00,
+  SIXP_PKT_RC_EOL = 0x01,
+  SIXP_PKT_RC_ERR = 0x02,
+  SIXP_PKT_RC_RESET = 0x03,
+  SIXP_PKT_RC_ERR_VERSION = 0x04,
+  SIXP_PKT_RC_ERR_SFID = 0x05,
+  SIXP_PKT_RC_ERR_SEQNUM = 0x06,
+  SIXP_PKT_RC_ERR_CELLLIST = 0x07,
+  SIXP_PKT_RC_ERR_BUSY = 0x08,
+  SIXP_PKT_RC_ERR_LOCKED = 0x09,
+} sixp_pkt_rc_t;
+
+typedef union {
+  sixp_pkt_cmd_t cmd;
+  sixp_pkt_rc_t rc;
+  uint8_t value;
+} sixp_pkt_code_t;
+
+typedef uint8_t sixp_pkt_cell_options_t;
+#define SIXP_PKT_CELL_OPTION_TX     0x01
+#define SIXP_PKT_CELL_OPTION_RX     0x02
+#define SIXP_PKT_CELL_OPTION_SHARED 0x04
+
+typedef uint16_t sixp_pkt_metadata_t;
+typedef uint8_t sixp_pkt_num_cells_t;
+typedef uint8_t sixp_pkt_reserved_t;
+typedef uint16_t sixp_pkt_offset_t;
+typedef uint16_t sixp_pkt_max_num_cells_t;
+typedef uint16_t sixp_pkt_total_num_cells_t;
+
+int sixp_pkt_set_metadata(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                          sixp_pkt_metadata_t metadata,
+                          uint8_t *body, uint16_t body_len);
+int sixp_pkt_get_metadata(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                          sixp_pkt_metadata_t *metadata,
+                          const uint8_t *body, uint16_t body_len);
+int sixp_pkt_set_cell_options(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                              sixp_pkt_cell_options_t cell_options,
+                              uint8_t *body, uint16_t body_len);
+int sixp_pkt_get_cell_options(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                              sixp_pkt_cell_options_t *cell_options,
+                              const uint8_t *body, uint16_t body_len);
+int sixp_pkt_set_num_cells(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                           sixp_pkt_num_cells_t num_cells,
+                           uint8_t *body, uint16_t body_len);
+int sixp_pkt_get_num_cells(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                           sixp_pkt_num_cells_t *num_cells,
+                           const uint8_t *body, uint16_t body_len);
+int sixp_pkt_set_reserved(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                          sixp_pkt_reserved_t reserved,
+                          uint8_t *body, uint16_t body_len);
+int sixp_pkt_set_offset(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                        sixp_pkt_offset_t cell_offset,
+                        uint8_t *body, uint16_t body_len);
+int sixp_pkt_get_offset(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                        sixp_pkt_offset_t *cell_offset,
+                        const uint8_t *body, uint16_t body_len);
+int sixp_pkt_set_max_num_cells(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                               sixp_pkt_max_num_cells_t max_num_cells,
+                               uint8_t *body, uint16_t body_len);
+int sixp_pkt_get_max_num_cells(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                               sixp_pkt_max_num_cells_t *max_num_cells,
+                               const uint8_t *body, uint16_t body_len);
+int sixp_pkt_set_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                           const uint8_t *cell_list, uint16_t cell_list_len,
+                           uint16_t cell_offset,
+                           uint8_t *body, uint16_t body_len);
+int sixp_pkt_get_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                           const uint8_t **cell_list,
+                           sixp_pkt_offset_t *cell_list_len,
+                           const uint8_t *body, uint16_t body_len);
+int sixp_pkt_set_rel_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                               const uint8_t *rel_cell_list,
+                               uint16_t rel_cell_list_len,
+                               uint16_t cell_offset,
+                               uint8_t *body, uint16_t body_len);
+int sixp_pkt_get_rel_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                               const uint8_t **rel_cell_list,
+                               sixp_pkt_offset_t *rel_cell_list_len,
+                               const uint8_t *body, uint16_t body_len);
+int sixp_pkt_set_cand_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                                const uint8_t *cand_cell_list,
+                                uint16_t cand_cell_list_len,
+                                uint16_t cell_offset,
+                                uint8_t *body, uint16_t body_len);
+int sixp_pkt_get_cand_cell_list(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                                const uint8_t **cand_cell_list,
+                                sixp_pkt_offset_t *cand_cell_list_len,
+                                const uint8_t *body, uint16_t body_len);
+int sixp_pkt_set_total_num_cells(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                                 sixp_pkt_total_num_cells_t total_num_cells,
+                                 uint8_t *body, uint16_t body_len);
+int sixp_pkt_get_total_num_cells(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                                 sixp_pkt_total_num_cells_t *total_num_cells,
+                                 const uint8_t *body, uint16_t body_len);
+
+/*---------------------------------------------------------------------------*/
+/* 6top: transactions, neighbours, output, scheduling functions */
+typedef enum {
+  SIXP_OUTPUT_STATUS_SUCCESS,
+  SIXP_OUTPUT_STATUS_FAILURE,
+  SIXP_OUTPUT_STATUS_ABORTED,
+} sixp_output_status_t;
+
+typedef void (*sixp_sent_callback_t)(void *arg, uint16_t arg_len,
+                                     const linkaddr_t *dest_addr,
+                                     sixp_output_status_t status);
+
+typedef struct sixp_nbr sixp_nbr_t;
+typedef struct sixp_trans sixp_trans_t;
+
+sixp_nbr_t *sixp_nbr_find(const linkaddr_t *addr);
+sixp_trans_t *sixp_trans_find(const linkaddr_t *peer_addr);
+sixp_pkt_cmd_t sixp_trans_get_cmd(sixp_trans_t *trans);
+
+int sixp_output(sixp_pkt_type_t type, sixp_pkt_code_t code, uint8_t sfid,
+                const uint8_t *body, uint16_t body_len,
+                const linkaddr_t *dest_addr,
+                sixp_sent_callback_t func, void *arg, uint16_t arg_len);
+
+typedef enum {
+  SIXP_ERROR_SCHEDULE_INCONSISTENCY,
+  SIXP_ERROR_TX_AFTER_TRANSACTION_COMPLETION,
+  SIXP_ERROR_INVALID_TRANS_STATE_TRANSITION,
+  SIXP_ERROR_UNDEFINED,
+} sixp_error_t;
+
+typedef void (*sf_init)(void);
+typedef void (*sf_input)(sixp_pkt_type_t type, sixp_pkt_code_t code,
+                         const uint8_t *body, uint16_t body_len,
+                         const linkaddr_t *src_addr);
+typedef void (*sf_timeout)(sixp_pkt_cmd_t cmd, const linkaddr_t *peer_addr);
+typedef void (*sf_error)(sixp_error_t err, sixp_pkt_cmd_t cmd, uint8_t seqno,
+                         const linkaddr_t *peer_addr);
+
+typedef struct {
+  uint8_t sfid;
+  clock_time_t timeout_interval;
+  sf_init init;
+  sf_input input;
+  sf_timeout timeout;
+  sf_error error;
+} sixtop_sf_t;
+
+/*---------------------------------------------------------------------------*/
+/* Debug output of sf-simple, printed with host_verbose only */
+#define DEBUG_NONE  0
+#define DEBUG_PRINT 1
+extern int host_verbose;
+int host_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+#define PRINTF(...) host_printf(__VA_ARGS__)
+#define PRINTLLADDR(addr) ((void)(addr))
+
+/*---------------------------------------------------------------------------*/
+/* Harness */
+#ifndef HOST_MAX_LINKS
+#define HOST_MAX_LINKS 1024
+#endif
+#ifndef HOST_MAX_SLOTFRAMES
+#define HOST_MAX_SLOTFRAMES 8
+#endif
+#ifndef HOST_MAX_TRANSACTIONS
+#define HOST_MAX_TRANSACTIONS 8
+#endif
+#ifndef HOST_MAX_TIMERS
+#define HOST_MAX_TIMERS 32
+#endif
+#define HOST_NUM_PEERS 4
+
+/* Neighbours of the node under test; the first one is its time source */
+extern const linkaddr_t host_peers[HOST_NUM_PEERS];
+
+/* Drop the schedule, the transactions, the timers and the queues, then
+ * initialise the scheduling function again */
+void host_reset(const sixtop_sf_t *sf, unsigned short seed);
+
+/* Deliver a 6P request from peer_addr, as 6P would once it accepted it.
+ * Returns -1 when a transaction with that peer is already going on. */
+int host_request(const linkaddr_t *peer_addr, sixp_pkt_cmd_t cmd,
+                 const uint8_t *body, uint16_t body_len);
+/* Deliver the response to our ongoing request to peer_addr */
+int host_response(const linkaddr_t *peer_addr, sixp_pkt_rc_t rc,
+                  const uint8_t *body, uint16_t body_len);
+/* Report the frame of the transaction with peer_addr as sent, which calls
+ * its sent callback, and close the transaction when it was the last one */
+int host_complete(const linkaddr_t *peer_addr, sixp_output_status_t status);
+/* Let the transaction with peer_addr time out */
+int host_timeout(const linkaddr_t *peer_addr);
+/* Report a 6P error on the transaction with peer_addr */
+int host_error(const linkaddr_t *peer_addr, sixp_error_t err);
+/* Fire every timer set, once */
+void host_fire_timers(void);
+/* Report the MAC outcome of a frame to peer_addr over the given cell */
+void host_sniff(const linkaddr_t *peer_addr, uint16_t slotframe,
+                uint16_t timeslot, int mac_status);
+/* Deliver a unicast frame from peer_addr; like TSCH, without the cell it
+ * came in over */
+void host_receive(const linkaddr_t *peer_addr);
+/* Frames queued to a peer */
+void host_set_queue(const linkaddr_t *peer_addr, int packet_count);
+/* Number of frames sixp_output accepted since the last reset, and the last
+ * of them */
+#define HOST_MAX_BODY 127
+struct host_frame {
+  sixp_pkt_type_t type;
+  sixp_pkt_code_t code;
+  linkaddr_t dest_addr;
+  uint16_t body_len;
+  uint8_t body[HOST_MAX_BODY];
+};
+extern unsigned long host_output_count;
+extern struct host_frame host_last_output;
+
+#endif /* HOST_CONTIKI_H_ */
@@ -0,0 +1,2 @@
+/* Host build stub, see host-contiki.h */
+#include "host-contiki.h"
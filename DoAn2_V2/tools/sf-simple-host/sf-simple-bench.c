@@ -0,0 +1,233 @@
+/*
+ * Microbenchmark of sf-simple on the host: time the handling of 6P
+ * requests and of sf_simple_add_links() against the stub TSCH and 6P
+ * layers of host-contiki.c, for a range of slotframe lengths and schedule
+ * fill levels. Each operation is undone by failing its transaction, so
+ * that every iteration sees the same schedule.
+ *
+ *   ./sf-simple-bench [-n iterations] [-s seed] [-v]
+ *
+ * Times are in nanoseconds per operation; "harness" is the cost of
+ * delivering a request sf-simple ignores, to be taken off the others.
+ */
+
+#include "host-contiki.h"
+#include "net/mac/tsch/sixtop/sixtop.h"
+#include "sf-simple.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static const uint16_t lengths[] = { 11, 17, 31, 61, 101, 251 };
+static const unsigned fills[] = { 0, 25, 50, 75, 95 };
+
+enum {
+  BENCH_HARNESS,
+  BENCH_ADD_REQ,
+  BENCH_DELETE_REQ,
+  BENCH_ADD_LINKS,
+  BENCH_NUM
+};
+
+static const char *bench_names[BENCH_NUM] = {
+  "harness", "add-req", "delete-req", "add-links"
+};
+
+/* The cells of the schedule given to peer 1, which it deletes */
+static uint8_t peer_cells[SF_SIMPLE_MAX_LINKS * 4];
+static unsigned num_peer_cells;
+/*---------------------------------------------------------------------------*/
+static double
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_cell(uint8_t *p, uint16_t timeslot, uint16_t channel_offset)
+{
+  p[0] = timeslot & 0xff;
+  p[1] = timeslot >> 8;
+  p[2] = channel_offset & 0xff;
+  p[3] = channel_offset >> 8;
+}
+/*---------------------------------------------------------------------------*/
+/* Both data slotframes of the given length, with fill percent of their
+ * timeslots given to peers 1 to 3 in turn */
+static unsigned
+setup(uint16_t length, unsigned fill, unsigned seed)
+{
+  static const uint16_t handles[] = {
+    SF_SIMPLE_UPLINK_SF_HANDLE, SF_SIMPLE_DOWNLINK_SF_HANDLE
+  };
+  struct tsch_slotframe *slotframe;
+  uint16_t timeslots[SF_SIMPLE_MAX_TIMESLOTS];
+  uint16_t tmp;
+  unsigned links = 0;
+  unsigned i, j, k;
+
+  host_reset(&sf_simple_driver, seed);
+  num_peer_cells = 0;
+
+  for(i = 0; i < sizeof(handles) / sizeof(handles[0]); i++) {
+    if((slotframe = tsch_schedule_get_slotframe_by_handle(handles[i])) != NULL) {
+      tsch_schedule_remove_slotframe(slotframe);
+    }
+    if((slotframe = tsch_schedule_add_slotframe(handles[i], length)) == NULL) {
+      fprintf(stderr, "Cannot add slotframe %u\n", handles[i]);
+      exit(1);
+    }
+
+    /* distinct timeslots, shuffled */
+    for(j = 0; j < length; j++) {
+      timeslots[j] = j;
+    }
+    for(j = length - 1; j > 0; j--) {
+      k = random_rand() % (j + 1);
+      tmp = timeslots[j];
+      timeslots[j] = timeslots[k];
+      timeslots[k] = tmp;
+    }
+
+    for(j = 0; j < length * fill / 100; j++) {
+      const linkaddr_t *peer = &host_peers[1 + j % (HOST_NUM_PEERS - 1)];
+      uint16_t channel_offset = random_rand() % 4;
+
+      tsch_schedule_add_link(slotframe, LINK_OPTION_RX, LINK_TYPE_NORMAL,
+                             peer, timeslots[j], channel_offset, 1);
+      links++;
+      if(handles[i] == SF_SIMPLE_DOWNLINK_SF_HANDLE && j % 3 == 0 &&
+         num_peer_cells < SF_SIMPLE_MAX_LINKS) {
+        put_cell(&peer_cells[num_peer_cells++ * 4],
+                 timeslots[j], channel_offset);
+      }
+    }
+  }
+  return links;
+}
+/*---------------------------------------------------------------------------*/
+/* Body of a request from peer 1 on the downlink slotframe */
+static uint16_t
+make_request(uint8_t *body, sixp_pkt_cmd_t cmd, uint16_t length)
+{
+  uint16_t len = 0;
+  unsigned i;
+
+  body[len++] = SF_SIMPLE_DOWNLINK_SF_HANDLE;
+  body[len++] = 0;
+  body[len++] = SIXP_PKT_CELL_OPTION_TX;
+  if(cmd == SIXP_PKT_CMD_DELETE) {
+    body[len++] = num_peer_cells;
+    memcpy(&body[len], peer_cells, num_peer_cells * 4);
+    len += num_peer_cells * 4;
+  } else {
+    body[len++] = SF_SIMPLE_MAX_LINKS / 2;
+    for(i = 0; i < SF_SIMPLE_MAX_LINKS; i++) {
+      put_cell(&body[len], random_rand() % length, random_rand() % 4);
+      len += 4;
+    }
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static double
+run(int bench, uint16_t length, unsigned long iterations)
+{
+  const linkaddr_t *child = &host_peers[1];
+  linkaddr_t parent;
+  uint8_t body[4 + 4 * SF_SIMPLE_MAX_LINKS];
+  uint16_t len;
+  unsigned long outputs = host_output_count;
+  unsigned long i;
+  double start;
+
+  linkaddr_copy(&parent, &host_peers[0]);
+  len = make_request(body,
+                     bench == BENCH_DELETE_REQ ?
+                     SIXP_PKT_CMD_DELETE : SIXP_PKT_CMD_ADD, length);
+
+  start = now_ns();
+  for(i = 0; i < iterations; i++) {
+    switch(bench) {
+    case BENCH_HARNESS:
+      host_request(child, SIXP_PKT_CMD_SIGNAL, body, len);
+      break;
+    case BENCH_ADD_REQ:
+      host_request(child, SIXP_PKT_CMD_ADD, body, len);
+      host_complete(child, SIXP_OUTPUT_STATUS_FAILURE);
+      break;
+    case BENCH_DELETE_REQ:
+      host_request(child, SIXP_PKT_CMD_DELETE, body, len);
+      host_complete(child, SIXP_OUTPUT_STATUS_FAILURE);
+      break;
+    case BENCH_ADD_LINKS:
+      sf_simple_add_links(&parent, SF_SIMPLE_MAX_LINKS);
+      host_timeout(&parent);
+      break;
+    }
+  }
+  start = (now_ns() - start) / iterations;
+
+  PRINTF("%s: %lu frames out of %lu iterations\n", bench_names[bench],
+         host_output_count - outputs, iterations);
+  return start;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  unsigned long iterations = 20000;
+  unsigned seed = 1;
+  unsigned links;
+  unsigned i, j;
+  int bench;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:s:v")) != -1) {
+    switch(opt) {
+    case 'n':
+      iterations = strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      seed = strtoul(optarg, NULL, 0);
+      break;
+    case 'v':
+      host_verbose = 1;
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-n iterations] [-s seed] [-v]\n", argv[0]);
+      return 2;
+    }
+  }
+  if(iterations == 0) {
+    iterations = 1;
+  }
+
+  printf("%6s %6s", "length", "links");
+  for(bench = 0; bench < BENCH_NUM; bench++) {
+    printf(" %10s", bench_names[bench]);
+  }
+  printf("   (ns/op)\n");
+
+  for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    for(j = 0; j < sizeof(fills) / sizeof(fills[0]); j++) {
+      printf("%6u", lengths[i]);
+      for(bench = 0; bench < BENCH_NUM; bench++) {
+        /* the same schedule for every operation */
+        links = setup(lengths[i], fills[j], seed);
+        if(bench == 0) {
+          printf(" %6u", links);
+        }
+        printf(" %10.0f", run(bench, lengths[i], iterations));
+      }
+      printf("\n");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,505 @@
+/*
+ * Fuzzer of sf-simple on the host: an input is a sequence of operations,
+ * 6P requests and responses with arbitrary bodies, completions, timeouts,
+ * errors, timer expiries, MAC reports, received frames and calls of the
+ * sf-simple API (the schedule dump with -v only), run against the stub
+ * TSCH and 6P layers of host-contiki.c. Built with the
+ * address and undefined behaviour sanitizers; the schedule is checked
+ * after every operation.
+ *
+ *   ./sf-simple-fuzz [-n runs] [-s seed] [-v]   random inputs
+ *   ./sf-simple-fuzz [-v] crash-file...         replay inputs
+ *
+ * The random inputs are built from well-formed 6P bodies which are then
+ * truncated, extended or corrupted. With clang, the same entry point links
+ * with libFuzzer instead (make sf-simple-fuzz-libfuzzer).
+ */
+
+#include "host-contiki.h"
+#include "net/mac/tsch/sixtop/sixtop.h"
+#include "sf-simple.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifdef __SANITIZE_ADDRESS__
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+/*
+ * Operation: op byte, arg byte, then for OP_REQUEST and OP_RESPONSE a
+ * length byte and the body. The high nibble of op picks the peer. With bit
+ * 7 of arg, a request or response carries the cells of the last frame
+ * sf-simple sent, so that peers grant, delete and relocate the very cells
+ * it proposed or installed:
+ *   request   body[0..3] (Metadata, CellOptions, NumCells), the cells,
+ *             then body[4..]
+ *   response  the first body[0] cells (all of them without a body), then
+ *             body[1..]
+ */
+enum {
+  OP_REQUEST,
+  OP_RESPONSE,
+  OP_COMPLETE,
+  OP_TIMEOUT,
+  OP_ERROR,
+  OP_TIMERS,
+  OP_SNIFF,
+  OP_API,
+  OP_QUEUE,
+  OP_PACKET_READY,
+  OP_ASSOCIATED,
+  OP_RECEIVE,
+  OP_DUMP,
+  OP_NUM
+};
+
+#define MAX_OPS 64
+#define MAX_BODY 255
+
+static const uint16_t data_slotframes[] = {
+  SF_SIMPLE_UPLINK_SF_HANDLE, SF_SIMPLE_DOWNLINK_SF_HANDLE
+};
+/*---------------------------------------------------------------------------*/
+/* Negotiated cells fit their slotframe, and take a timeslot of their own */
+static void
+check_schedule(void)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  struct tsch_link *m;
+  unsigned i;
+
+  for(i = 0; i < sizeof(data_slotframes) / sizeof(data_slotframes[0]); i++) {
+    if((sf = tsch_schedule_get_slotframe_by_handle(data_slotframes[i])) == NULL) {
+      continue;
+    }
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+      if(l->timeslot >= sf->size.val) {
+        fprintf(stderr, "link %u/%u beyond slotframe length %u\n",
+                l->timeslot, sf->handle, sf->size.val);
+        abort();
+      }
+      for(m = list_item_next(l); m != NULL; m = list_item_next(m)) {
+        if(m->timeslot == l->timeslot) {
+          fprintf(stderr, "links (%u,%u) and (%u,%u) share timeslot %u/%u\n",
+                  l->timeslot, l->channel_offset,
+                  m->timeslot, m->channel_offset, l->timeslot, sf->handle);
+          abort();
+        }
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* A frame received from a peer is counted against the data slotframe of
+ * our RX cells from it, or else the one the peer would add them in: the
+ * downlink slotframe for the time source, the uplink one for a child */
+static void
+check_receive(const linkaddr_t *peer)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  uint16_t expected = linkaddr_cmp(peer, &host_peers[0]) ?
+    SF_SIMPLE_DOWNLINK_SF_HANDLE : SF_SIMPLE_UPLINK_SF_HANDLE;
+  uint16_t other;
+  uint16_t before, before_other, after;
+  unsigned i;
+
+  for(i = 0; i < sizeof(data_slotframes) / sizeof(data_slotframes[0]); i++) {
+    if((sf = tsch_schedule_get_slotframe_by_handle(data_slotframes[i])) == NULL) {
+      continue;
+    }
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+      if(l->link_options == LINK_OPTION_RX && linkaddr_cmp(&l->addr, peer)) {
+        break;
+      }
+    }
+    if(l != NULL) {
+      expected = sf->handle;
+      break;
+    }
+  }
+  other = expected == SF_SIMPLE_UPLINK_SF_HANDLE ?
+    SF_SIMPLE_DOWNLINK_SF_HANDLE : SF_SIMPLE_UPLINK_SF_HANDLE;
+
+  before = sf_simple_rx_frames(peer, expected);
+  before_other = sf_simple_rx_frames(peer, other);
+  host_receive(peer);
+  after = sf_simple_rx_frames(peer, expected);
+
+  /* a full table leaves a new neighbour uncounted */
+  if(sf_simple_rx_frames(peer, other) != before_other ||
+     (before < 0xffff && after != before + 1 && !(before == 0 && after == 0))) {
+    fprintf(stderr, "frame counted against the wrong slotframe: "
+            "%u -> %u in %u, %u -> %u in %u\n", before, after, expected,
+            before_other, sf_simple_rx_frames(peer, other), other);
+    abort();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Cells of the last frame sf-simple sent: candidates or granted cells */
+static uint16_t
+last_output_cells(const uint8_t **cells)
+{
+  const struct host_frame *f = &host_last_output;
+  sixp_pkt_offset_t len;
+
+  if(sixp_pkt_get_cell_list(f->type, f->code, cells, &len,
+                            f->body, f->body_len) == 0 ||
+     sixp_pkt_get_cand_cell_list(f->type, f->code, cells, &len,
+                                 f->body, f->body_len) == 0) {
+    return len;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+echo_body(uint8_t *echo, int request, const uint8_t *body, uint16_t body_len)
+{
+  const uint8_t *cells;
+  uint16_t cells_len = last_output_cells(&cells);
+  uint16_t head = MIN(body_len, request ? 4 : 1);
+  uint16_t len = 0;
+
+  if(request) {
+    memset(echo, 0, 4);
+    memcpy(echo, body, head);
+    len = 4;
+  } else if(head > 0) {
+    cells_len = MIN(cells_len, body[0] * 4);
+  }
+  if(cells_len > 0) {
+    memcpy(&echo[len], cells, cells_len);
+    len += cells_len;
+  }
+  memcpy(&echo[len], &body[head], body_len - head);
+  return len + body_len - head;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_api(linkaddr_t *peer, uint8_t arg)
+{
+  switch(arg & 3) {
+  case 0:
+    sf_simple_add_links(peer, arg >> 2);
+    break;
+  case 1:
+    sf_simple_remove_links(peer);
+    break;
+  case 2:
+    sf_simple_sync_links(peer);
+    break;
+  default:
+    sf_simple_clear_links(peer);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  const uint8_t *end = data + size;
+  uint8_t echo[4 + HOST_MAX_BODY + MAX_BODY];
+  const uint8_t *body;
+  linkaddr_t peer;
+  uint8_t op;
+  uint8_t arg;
+  uint16_t len;
+  int ops = 0;
+  unsigned i;
+
+  host_reset(&sf_simple_driver, size > 0 ? data[0] : 0);
+
+  while(end - data >= 2 && ops++ < MAX_OPS) {
+    op = data[0];
+    arg = data[1];
+    data += 2;
+    linkaddr_copy(&peer, &host_peers[(op >> 4) % HOST_NUM_PEERS]);
+
+    switch((op & 0x0f) % OP_NUM) {
+    case OP_REQUEST:
+    case OP_RESPONSE:
+      len = data < end ? *data++ : 0;
+      len = MIN(len, end - data);
+      body = data;
+      data += len;
+      if(arg & 0x80) {
+        len = echo_body(echo, (op & 0x0f) % OP_NUM == OP_REQUEST, body, len);
+        body = echo;
+      }
+      if((op & 0x0f) % OP_NUM == OP_REQUEST) {
+        host_request(&peer, arg & 0x07, body, len);
+      } else {
+        host_response(&peer, (arg & 0x7f) % (SIXP_PKT_RC_ERR_LOCKED + 1),
+                      body, len);
+      }
+      break;
+    case OP_COMPLETE:
+      host_complete(&peer, arg % 3);
+      break;
+    case OP_TIMEOUT:
+      host_timeout(&peer);
+      break;
+    case OP_ERROR:
+      host_error(&peer, arg % 4);
+      break;
+    case OP_TIMERS:
+      /* long runs reach the periodic evaluation and time source sync */
+      for(i = 0; i <= arg % 64; i++) {
+        host_fire_timers();
+        /* about a second of 10 ms timeslots per round */
+        tsch_current_asn.ls4b += 100;
+      }
+      break;
+    case OP_SNIFF:
+      host_sniff(&peer, data_slotframes[arg & 1], (arg >> 1) % 32,
+                 (arg >> 6) == 3 ? MAC_TX_QUEUE_FULL : arg >> 6);
+      break;
+    case OP_API:
+      run_api(&peer, arg);
+      break;
+    case OP_QUEUE:
+      host_set_queue(&peer, arg);
+      break;
+    case OP_PACKET_READY:
+      packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
+                         (arg & 1) ? &linkaddr_null : &peer);
+      packetbuf_set_attr(PACKETBUF_ATTR_MAC_METADATA, (arg >> 1) & 1);
+      sf_simple_callback_packet_ready();
+      if(arg & 4) {
+        sf_simple_callback_new_time_source(NULL, NULL);
+      }
+      break;
+    case OP_ASSOCIATED:
+      tsch_is_associated = arg & 1;
+      break;
+    case OP_RECEIVE:
+      check_receive(&peer);
+      break;
+    case OP_DUMP:
+      if(host_verbose) {
+        sf_simple_print_cells();
+      }
+      break;
+    }
+    check_schedule();
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#ifndef SF_SIMPLE_FUZZ_LIBFUZZER
+static uint8_t input[MAX_OPS * (3 + MAX_BODY)];
+static size_t input_len;
+
+static unsigned
+draw(unsigned n)
+{
+  return n == 0 ? 0 : (unsigned)rand() % n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put(uint8_t byte)
+{
+  if(input_len < sizeof(input)) {
+    input[input_len++] = byte;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* A 6P body, well-formed more often than not, then damaged */
+static uint16_t
+make_body(uint8_t *body, int request, uint8_t code)
+{
+  uint16_t len = 0;
+  unsigned num_cells = draw(8);
+  unsigned num_listed = draw(4) == 0 ? draw(12) : num_cells;
+  unsigned i;
+
+  if(request) {
+    /* Metadata: the uplink or downlink slotframe, or anything else */
+    body[len++] = draw(8) == 0 ? draw(256) : 1 + draw(2);
+    body[len++] = draw(8) == 0 ? draw(256) : 0;
+    body[len++] = draw(4) == 0 ? draw(256) : 1 + draw(2);
+    if(code == SIXP_PKT_CMD_LIST) {
+      body[len++] = 0;
+      body[len++] = draw(4);
+      body[len++] = 0;
+      body[len++] = draw(8);
+      body[len++] = 0;
+    } else if(code != SIXP_PKT_CMD_COUNT && code != SIXP_PKT_CMD_CLEAR) {
+      body[len++] = num_cells;
+      if(code == SIXP_PKT_CMD_RELOCATE) {
+        num_listed += num_cells;
+      }
+    }
+  } else if(draw(6) == 0) {
+    /* TotalNumCells of a COUNT response */
+    body[len++] = draw(8);
+    body[len++] = 0;
+    num_listed = 0;
+  }
+  for(i = 0; i < num_listed && len + 4 <= MAX_BODY; i++) {
+    /* mostly cells within the slotframes, on existing channel offsets */
+    body[len++] = draw(8) == 0 ? draw(256) : draw(20);
+    body[len++] = draw(16) == 0 ? draw(256) : 0;
+    body[len++] = draw(8) == 0 ? draw(256) : draw(5);
+    body[len++] = draw(16) == 0 ? 0xff : 0;
+  }
+
+  switch(draw(6)) {
+  case 0:
+    len = draw(len + 1);
+    break;
+  case 1:
+    for(i = draw(4); i > 0 && len < MAX_BODY; i--) {
+      body[len++] = draw(256);
+    }
+    break;
+  case 2:
+    if(len > 0) {
+      body[draw(len)] ^= 1 << draw(8);
+    }
+    break;
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_input(void)
+{
+  uint8_t body[MAX_BODY];
+  unsigned ops = 1 + draw(MAX_OPS);
+  uint8_t op;
+  uint8_t arg;
+  uint16_t len;
+  uint16_t i;
+
+  input_len = 0;
+  while(ops-- > 0) {
+    op = draw(OP_NUM);
+    /* requests and responses come first of all */
+    if(draw(2) == 0) {
+      op = draw(2) == 0 ? OP_REQUEST : OP_RESPONSE;
+    }
+    arg = draw(256);
+    if(op == OP_REQUEST && draw(8) != 0) {
+      arg = SIXP_PKT_CMD_ADD + draw(SIXP_PKT_CMD_CLEAR);
+    } else if(op == OP_RESPONSE && draw(4) != 0) {
+      arg = draw(2);
+    }
+    if((op == OP_REQUEST || op == OP_RESPONSE) && draw(2) == 0) {
+      arg |= 0x80;
+    }
+    put(op | draw(HOST_NUM_PEERS) << 4);
+    put(arg);
+    if((op == OP_REQUEST || op == OP_RESPONSE) && (arg & 0x80)) {
+      /* the head of the body only, and a few cells or bytes more */
+      len = make_body(body, op == OP_REQUEST, arg & 0x07);
+      len = op == OP_REQUEST ? MIN(len, 4 + 4 * draw(3)) : draw(8) == 0 ? 0 : 1;
+      if(op == OP_RESPONSE && len > 0) {
+        body[0] = draw(SF_SIMPLE_MAX_LINKS + 1);
+      } else if(op == OP_REQUEST && len > 3) {
+        body[3] = draw(SF_SIMPLE_MAX_LINKS + 1);
+      }
+      put(len);
+      for(i = 0; i < len; i++) {
+        put(body[i]);
+      }
+    } else if(op == OP_REQUEST || op == OP_RESPONSE) {
+      len = make_body(body, op == OP_REQUEST, arg & 0x07);
+      put(len);
+      for(i = 0; i < len; i++) {
+        put(body[i]);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Save the input that failed, to be replayed */
+static void
+save_input(void)
+{
+  FILE *f;
+
+  if((f = fopen("sf-simple-fuzz.crash", "wb")) != NULL) {
+    fwrite(input, 1, input_len, f);
+    fclose(f);
+    fprintf(stderr, "input saved to sf-simple-fuzz.crash\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+failed(int sig)
+{
+  save_input();
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+/*---------------------------------------------------------------------------*/
+static int
+replay(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+
+  if(f == NULL) {
+    perror(path);
+    return -1;
+  }
+  input_len = fread(input, 1, sizeof(input), f);
+  fclose(f);
+  LLVMFuzzerTestOneInput(input, input_len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  unsigned long runs = 100000;
+  unsigned long run;
+  unsigned seed = 1;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:s:v")) != -1) {
+    switch(opt) {
+    case 'n':
+      runs = strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      seed = strtoul(optarg, NULL, 0);
+      break;
+    case 'v':
+      /* unbuffered: the trace must not be lost on abort */
+      setvbuf(stdout, NULL, _IONBF, 0);
+      host_verbose = 1;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n runs] [-s seed] [-v] [input...]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if(optind < argc) {
+    for(; optind < argc; optind++) {
+      if(replay(argv[optind]) < 0) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+#ifdef __SANITIZE_ADDRESS__
+  __sanitizer_set_death_callback(save_input);
+#endif
+  signal(SIGABRT, failed);
+  signal(SIGSEGV, failed);
+  srand(seed);
+  for(run = 0; run < runs; run++) {
+    make_input();
+    LLVMFuzzerTestOneInput(input, input_len);
+  }
+  printf("%lu inputs, seed %u: no failure\n", runs, seed);
+  return 0;
+}
+#endif /* SF_SIMPLE_FUZZ_LIBFUZZER */
@@ -0,0 +1,129 @@
+/*
+ * Regression tests of sf-simple on the host: whole 6P transactions played
+ * against the stub TSCH and 6P layers of host-contiki.c, one end at a
+ * time, the frames of one end fed to the other.
+ *
+ *   ./sf-simple-test [-v]
+ *
+ * Exits with status 1 when a check fails.
+ */
+
+#include "host-contiki.h"
+#include "net/mac/tsch/sixtop/sixtop.h"
+#include "sf-simple.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHECK(cond) do {                                          \
+    if(!(cond)) {                                                 \
+      fprintf(stderr, "%s:%d: %s: check failed: %s\n",            \
+              __FILE__, __LINE__, __func__, #cond);               \
+      failures++;                                                 \
+    }                                                             \
+  } while(0)
+
+#define TIMESLOT       3
+#define CHANNEL_OFFSET 1
+
+static unsigned failures;
+/*---------------------------------------------------------------------------*/
+/* The cell of the tests, in the given slotframe, created if needed */
+static struct tsch_link *
+add_cell(uint16_t handle, uint8_t link_options, const linkaddr_t *peer_addr)
+{
+  struct tsch_slotframe *slotframe;
+
+  if((slotframe = tsch_schedule_get_slotframe_by_handle(handle)) == NULL) {
+    slotframe = tsch_schedule_add_slotframe(handle, 17);
+  }
+  return tsch_schedule_add_link(slotframe, link_options, LINK_TYPE_NORMAL,
+                                peer_addr, TIMESLOT, CHANNEL_OFFSET, 1);
+}
+
+static struct tsch_link *
+find_cell(uint16_t handle)
+{
+  struct tsch_slotframe *slotframe =
+    tsch_schedule_get_slotframe_by_handle(handle);
+
+  return slotframe == NULL ? NULL :
+         tsch_schedule_get_link_by_offsets(slotframe, TIMESLOT,
+                                           CHANNEL_OFFSET);
+}
+/*---------------------------------------------------------------------------*/
+/* A DELETE of one of our TX cells to a child, which holds it as an RX
+ * cell: the cell goes on both ends */
+static void
+test_delete_round_trip(void)
+{
+  const linkaddr_t *child = &host_peers[1];
+  const linkaddr_t *parent = &host_peers[0];
+  struct host_frame request;
+  struct host_frame response;
+  sixp_pkt_cell_options_t cell_options;
+
+  /* requester: the parent, deleting its TX cell to the child */
+  host_reset(&sf_simple_driver, 1);
+  CHECK(add_cell(SF_SIMPLE_DOWNLINK_SF_HANDLE, LINK_OPTION_TX,
+                 child) != NULL);
+  CHECK(sf_simple_remove_links((linkaddr_t *)child) == 0);
+  CHECK(host_output_count == 1);
+  request = host_last_output;
+  CHECK(request.type == SIXP_PKT_TYPE_REQUEST &&
+        request.code.value == SIXP_PKT_CMD_DELETE);
+  CHECK(sixp_pkt_get_cell_options(SIXP_PKT_TYPE_REQUEST,
+                                  (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                                  &cell_options,
+                                  request.body, request.body_len) == 0 &&
+        cell_options == SIXP_PKT_CELL_OPTION_TX);
+
+  /* responder: the child, whose time source is host_peers[0] */
+  host_reset(&sf_simple_driver, 1);
+  CHECK(add_cell(SF_SIMPLE_DOWNLINK_SF_HANDLE, LINK_OPTION_RX,
+                 parent) != NULL);
+  CHECK(host_request(parent, SIXP_PKT_CMD_DELETE,
+                     request.body, request.body_len) == 0);
+  response = host_last_output;
+  CHECK(response.type == SIXP_PKT_TYPE_RESPONSE &&
+        response.code.value == SIXP_PKT_RC_SUCCESS);
+  CHECK(response.body_len == 4);  /* the one cell */
+  CHECK(host_complete(parent, SIXP_OUTPUT_STATUS_SUCCESS) == 0);
+  CHECK(find_cell(SF_SIMPLE_DOWNLINK_SF_HANDLE) == NULL);
+
+  /* requester again, given the response */
+  host_reset(&sf_simple_driver, 1);
+  CHECK(add_cell(SF_SIMPLE_DOWNLINK_SF_HANDLE, LINK_OPTION_TX,
+                 child) != NULL);
+  CHECK(sf_simple_remove_links((linkaddr_t *)child) == 0);
+  CHECK(host_response(child, SIXP_PKT_RC_SUCCESS,
+                      response.body, response.body_len) == 0);
+  CHECK(find_cell(SF_SIMPLE_DOWNLINK_SF_HANDLE) == NULL);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  int opt;
+
+  while((opt = getopt(argc, argv, "v")) != -1) {
+    switch(opt) {
+    case 'v':
+      host_verbose = 1;
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  test_delete_round_trip();
+
+  if(failures > 0) {
+    fprintf(stderr, "%u checks failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,224 @@
+/**
+ * \file
+ *         Traffic classes of the datagrams this node sends or forwards
+ *
+ * Bulk is admitted only while the TSCH queue of its next hop is short,
+ * and gets fewer MAC transmissions. It is also pinned to a negotiated
+ * cell, and TSCH only looks at the head of the queue of a neighbour: a
+ * pinned bulk frame there would hold every frame behind it until its
+ * cell comes. So whenever a frame that can take any cell is queued
+ * (control, latency and 6P), it is moved ahead of the pinned bulk frames
+ * of its neighbour that have not been sent yet. TSCH has no interface for
+ * this: promote() rewrites its private queue state, see there.
+ */
+
+#include "traffic-class.h"
+#include "telemetry.h"
+#include "net/netstack.h"
+#include "net/queuebuf.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uipbuf.h"
+#include "net/mac/tsch/tsch.h"
+#include "sf-simple.h"
+
+#include "sys/log.h"
+#define LOG_MODULE "Traffic Class"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+static uint16_t udp_port;
+static uint8_t current_class = TRAFFIC_CLASS_CONTROL;
+static uint16_t drops;
+
+/* Neighbours to which a frame was queued that should overtake bulk */
+#define PROMOTE_NBRS 4
+static linkaddr_t promote_addrs[PROMOTE_NBRS];
+static uint8_t num_promote;
+
+PROCESS(traffic_class_process, "Traffic class");
+
+/*---------------------------------------------------------------------------*/
+static uint8_t
+classify(void)
+{
+  struct uip_udp_hdr *udp;
+  uint8_t protocol;
+  uint8_t *payload;
+  int type;
+
+  udp = (struct uip_udp_hdr *)uipbuf_get_last_header(uip_buf, uip_len,
+                                                     &protocol);
+  if(udp == NULL || protocol == UIP_PROTO_ICMP6) {
+    return TRAFFIC_CLASS_CONTROL;
+  }
+  if(protocol != UIP_PROTO_UDP ||
+     (udp->destport != UIP_HTONS(udp_port) &&
+      udp->srcport != UIP_HTONS(udp_port))) {
+    return TRAFFIC_CLASS_BULK;
+  }
+
+  payload = (uint8_t *)udp + UIP_UDPH_LEN;
+  type = telemetry_type(payload, uip_buf + uip_len - payload);
+  if(type == TELEMETRY_TYPE_PING || type == TELEMETRY_TYPE_PONG) {
+    return TRAFFIC_CLASS_LATENCY;
+  }
+  return TRAFFIC_CLASS_BULK;
+}
+
+static enum netstack_ip_action
+class_output(const linkaddr_t *localdest)
+{
+  struct tsch_neighbor *n;
+
+  current_class = classify();
+  if(current_class != TRAFFIC_CLASS_BULK) {
+    return NETSTACK_IP_PROCESS;
+  }
+
+  n = localdest != NULL ? tsch_queue_get_nbr(localdest) : NULL;
+  if((n != NULL &&
+      tsch_queue_nbr_packet_count(n) >= TRAFFIC_CLASS_BULK_QUEUE_LIMIT) ||
+     tsch_queue_global_packet_count() >=
+     QUEUEBUF_NUM - TRAFFIC_CLASS_RESERVED_BUFFERS) {
+    drops++;
+    LOG_DBG("Bulk datagram dropped, %u so far\n", drops);
+    return NETSTACK_IP_DROP;
+  }
+
+#if TRAFFIC_CLASS_BULK_MAX_TRANSMISSIONS
+  uipbuf_set_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                  TRAFFIC_CLASS_BULK_MAX_TRANSMISSIONS);
+#endif /* TRAFFIC_CLASS_BULK_MAX_TRANSMISSIONS */
+  return NETSTACK_IP_PROCESS;
+}
+
+static struct netstack_ip_packet_processor class_processor = {
+  .process_input = NULL,
+  .process_output = class_output
+};
+/*---------------------------------------------------------------------------*/
+/* Bulk frame waiting for its own cell, which others may overtake */
+static int
+is_pinned(struct tsch_packet *p)
+{
+  uint16_t slotframe = queuebuf_attr(p->qb, PACKETBUF_ATTR_TSCH_SLOTFRAME);
+
+  return p->transmissions == 0 && slotframe != 0xffff &&
+         slotframe != SF_SIMPLE_CONTROL_SF_HANDLE;
+}
+
+/* Stable reordering of the queue of a neighbour, frames that can take any
+ * cell before the pinned ones; to be called with the TSCH lock held.
+ *
+ * This rewrites TSCH private state and relies on the Contiki-NG 4.x queue
+ * (tsch-types.h, tsch-queue.c):
+ * - the frames of a neighbour are n->tx_array[] indexed by the ringbufindex
+ *   n->tx_ringbuf, the k-th oldest at (get_ptr + k) & mask, and TSCH reads
+ *   no other copy of that order;
+ * - TSCH takes the head frame and removes it with ringbufindex_get() within
+ *   one slot operation, and tsch_queue_remove_packet_from_queue() does
+ *   nothing while the lock is held, so the head cannot change under us.
+ * The Makefile stops the build when the tree lacks that queue layout. */
+static void
+promote(struct tsch_neighbor *n)
+{
+  struct ringbufindex *r = &n->tx_ringbuf;
+  struct tsch_packet *p;
+  int count = ringbufindex_elements(r);
+  int i, j;
+
+#define QUEUED(k) n->tx_array[(r->get_ptr + (k)) & r->mask]
+  for(i = 1; i < count; i++) {
+    p = QUEUED(i);
+    if(is_pinned(p)) {
+      continue;
+    }
+    for(j = i; j > 0 && is_pinned(QUEUED(j - 1)); j--) {
+      QUEUED(j) = QUEUED(j - 1);
+    }
+    if(j != i) {
+      QUEUED(j) = p;
+      LOG_DBG("Frame %d to ", i);
+      LOG_DBG_LLADDR(&n->addr);
+      LOG_DBG_(" moved to %d\n", j);
+    }
+  }
+#undef QUEUED
+}
+
+PROCESS_THREAD(traffic_class_process, ev, data)
+{
+  struct tsch_neighbor *n;
+  int i;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    if(!tsch_get_lock()) {
+      /* the queues are being changed; come back later */
+      process_poll(&traffic_class_process);
+      continue;
+    }
+    for(i = 0; i < num_promote; i++) {
+      if((n = tsch_queue_get_nbr(&promote_addrs[i])) != NULL) {
+        promote(n);
+      }
+    }
+    num_promote = 0;
+    tsch_release_lock();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+traffic_class_init(uint16_t port)
+{
+  udp_port = port;
+  netstack_ip_packet_processor_add(&class_processor);
+  process_start(&traffic_class_process, NULL);
+}
+
+uint8_t
+traffic_class_current(void)
+{
+  return current_class;
+}
+
+uint16_t
+traffic_class_drops(void)
+{
+  return drops;
+}
+
+int
+traffic_class_callback_pin_packet(void)
+{
+  return current_class == TRAFFIC_CLASS_BULK;
+}
+
+int
+traffic_class_callback_packet_ready(void)
+{
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  int ret = sf_simple_callback_packet_ready();
+  uint16_t slotframe = packetbuf_attr(PACKETBUF_ATTR_TSCH_SLOTFRAME);
+  int i;
+
+  if(linkaddr_cmp(dest, &linkaddr_null) ||
+     (slotframe != 0xffff && slotframe != SF_SIMPLE_CONTROL_SF_HANDLE)) {
+    return ret;
+  }
+  for(i = 0; i < num_promote; i++) {
+    if(linkaddr_cmp(&promote_addrs[i], dest)) {
+      break;
+    }
+  }
+  if(i == num_promote && num_promote < PROMOTE_NBRS) {
+    linkaddr_copy(&promote_addrs[num_promote++], dest);
+  }
+  /* the frame is queued once this returns */
+  process_poll(&traffic_class_process);
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,64 @@
+/**
+ * \file
+ *         Traffic classes of the datagrams this node sends or forwards
+ *
+ * Classes follow the message type byte set by the application: ICMPv6
+ * (RPL, ND) is control, PING/PONG probes are latency-sensitive, and sensor
+ * reports and batches are bulk. 6P never reaches the IPv6 layer; sf-simple
+ * keeps it in the control slotframe.
+ */
+
+#ifndef TRAFFIC_CLASS_H_
+#define TRAFFIC_CLASS_H_
+
+#include "contiki.h"
+
+#define TRAFFIC_CLASS_CONTROL 0
+#define TRAFFIC_CLASS_LATENCY 1
+#define TRAFFIC_CLASS_BULK    2
+
+/* Bulk datagrams are dropped once this many frames wait for the next hop,
+ * which leaves the rest of the queue to control and latency traffic */
+#ifdef TRAFFIC_CLASS_CONF_BULK_QUEUE_LIMIT
+#define TRAFFIC_CLASS_BULK_QUEUE_LIMIT TRAFFIC_CLASS_CONF_BULK_QUEUE_LIMIT
+#else
+#define TRAFFIC_CLASS_BULK_QUEUE_LIMIT 4
+#endif
+
+/* Bulk datagrams are dropped as well when fewer than this many queue
+ * buffers are left over all neighbours */
+#ifdef TRAFFIC_CLASS_CONF_RESERVED_BUFFERS
+#define TRAFFIC_CLASS_RESERVED_BUFFERS TRAFFIC_CLASS_CONF_RESERVED_BUFFERS
+#else
+#define TRAFFIC_CLASS_RESERVED_BUFFERS 4
+#endif
+
+/* Transmissions allowed to a bulk frame, so that a lossy link does not
+ * hold the head of the queue for long; 0 keeps the MAC default */
+#ifdef TRAFFIC_CLASS_CONF_BULK_MAX_TRANSMISSIONS
+#define TRAFFIC_CLASS_BULK_MAX_TRANSMISSIONS TRAFFIC_CLASS_CONF_BULK_MAX_TRANSMISSIONS
+#else
+#define TRAFFIC_CLASS_BULK_MAX_TRANSMISSIONS 3
+#endif
+
+/* Start classifying the datagrams, those to the given UDP port by their
+ * message type */
+void traffic_class_init(uint16_t port);
+
+/* Class of the datagram being sent, valid down to the MAC for as long as
+ * it is handed the frames of that datagram */
+uint8_t traffic_class_current(void);
+
+/* Bulk datagrams dropped so far */
+uint16_t traffic_class_drops(void);
+
+/* For sf-simple: pin only bulk frames to a negotiated cell, let the others
+ * take the first cell to their neighbour */
+int traffic_class_callback_pin_packet(void);
+
+/* For TSCH_CALLBACK_PACKET_READY: runs sf_simple_callback_packet_ready,
+ * then has the frame overtake the pinned bulk frames queued to the same
+ * neighbour unless it is pinned itself */
+int traffic_class_callback_packet_ready(void);
+
+#endif /* TRAFFIC_CLASS_H_ */
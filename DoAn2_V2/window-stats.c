@@ -0,0 +1,143 @@
+/**
+ * \file
+ *         Recent delivery statistics of a sensor node, as seen by the
+ *         coordinator
+ */
+
+#include "window-stats.h"
+
+#include <string.h>
+
+#define FIXED(x) ((int32_t)(x) * (1 << WINDOW_STATS_FRAC_BITS))
+
+/*---------------------------------------------------------------------------*/
+/* Move the window to the current time, emptying the slots it enters */
+static void
+advance(window_stats_t *w)
+{
+  clock_time_t elapsed = (clock_time() - w->slot_start) /
+    WINDOW_STATS_SLOT_DURATION;
+
+  if(elapsed >= WINDOW_STATS_SLOTS) {
+    memset(w->slots, 0, sizeof(w->slots));
+    w->slot_start = clock_time();
+    return;
+  }
+  for(; elapsed > 0; elapsed--) {
+    w->current = (w->current + 1) % WINDOW_STATS_SLOTS;
+    memset(&w->slots[w->current], 0, sizeof(w->slots[w->current]));
+    w->slot_start += WINDOW_STATS_SLOT_DURATION;
+  }
+}
+
+/* One step of a moving average, or its first sample */
+static void
+average(int32_t *avg, int32_t sample, int first)
+{
+  if(first) {
+    *avg = sample;
+  } else {
+    *avg += (sample - *avg) / (1 << WINDOW_STATS_EWMA_SHIFT);
+  }
+}
+
+/* Increment of a counter of the node since its previous report; a counter
+ * going back means the node rebooted or reports were reordered */
+static uint16_t
+increment(uint16_t now, uint16_t before)
+{
+  uint16_t delta = now - before;
+
+  return delta < 0x8000 ? delta : 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+window_stats_init(window_stats_t *w)
+{
+  memset(w, 0, sizeof(*w));
+  w->slot_start = clock_time();
+  w->loss = -1;
+  w->rtt = -1;
+}
+
+void
+window_stats_update(window_stats_t *w, const telemetry_sensor_t *report,
+                    int16_t rssi)
+{
+  window_stats_slot_t *slot;
+  uint16_t sent = 1;
+  uint16_t pings = 0;
+  uint16_t pongs = 0;
+
+  advance(w);
+  slot = &w->slots[w->current];
+
+  if(w->reports > 0) {
+    sent = increment(report->tx_count, w->tx_count);
+    if(sent == 0) {
+      sent = 1;
+    }
+    pings = increment(report->ping_sent, w->ping_sent);
+    pongs = increment(report->pong_received, w->pong_received);
+  }
+  w->tx_count = report->tx_count;
+  w->ping_sent = report->ping_sent;
+  w->pong_received = report->pong_received;
+
+  slot->sent += sent;
+  slot->received++;
+  slot->pings += pings;
+  slot->pongs += pongs;
+
+  average(&w->prr, FIXED(100) / sent, w->reports == 0);
+  average(&w->rssi, FIXED(rssi), w->reports == 0);
+  if(pings > 0) {
+    average(&w->loss, FIXED(pings > pongs ? pings - pongs : 0) * 100 / pings,
+            w->loss < 0);
+  }
+  if(pongs > 0) {
+    average(&w->rtt, FIXED(report->rtt), w->rtt < 0);
+  }
+
+  if(w->reports < 0xff) {
+    w->reports++;
+  }
+}
+
+uint16_t
+window_stats_prr(window_stats_t *w)
+{
+  uint32_t sent = 0;
+  uint32_t received = 0;
+  int i;
+
+  advance(w);
+  for(i = 0; i < WINDOW_STATS_SLOTS; i++) {
+    sent += w->slots[i].sent;
+    received += w->slots[i].received;
+  }
+  if(sent == 0) {
+    return WINDOW_STATS_UNKNOWN;
+  }
+  /* A report can land in the slot after the one its predecessors counted in */
+  return received >= sent ? 100 : received * 100 / sent;
+}
+
+uint16_t
+window_stats_loss(window_stats_t *w)
+{
+  uint32_t pings = 0;
+  uint32_t pongs = 0;
+  int i;
+
+  advance(w);
+  for(i = 0; i < WINDOW_STATS_SLOTS; i++) {
+    pings += w->slots[i].pings;
+    pongs += w->slots[i].pongs;
+  }
+  if(pings == 0) {
+    return WINDOW_STATS_UNKNOWN;
+  }
+  return pongs >= pings ? 0 : (pings - pongs) * 100 / pings;
+}
+/*---------------------------------------------------------------------------*/
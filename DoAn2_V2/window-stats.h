@@ -0,0 +1,80 @@
+/**
+ * \file
+ *         Recent delivery statistics of a sensor node, as seen by the
+ *         coordinator
+ *
+ * PRR and PING loss are counted over a sliding window of
+ * WINDOW_STATS_SLOTS slots of WINDOW_STATS_SLOT_DURATION each, from the
+ * differences between the counters of consecutive reports, so that they
+ * survive the wrap of the 16-bit counters of the node. PRR, loss, RTT and
+ * RSSI are also smoothed by exponential moving averages. All arithmetic is
+ * integer: averages keep WINDOW_STATS_FRAC_BITS fractional bits.
+ */
+
+#ifndef WINDOW_STATS_H_
+#define WINDOW_STATS_H_
+
+#include "contiki.h"
+#include "telemetry.h"
+
+#ifdef WINDOW_STATS_CONF_SLOTS
+#define WINDOW_STATS_SLOTS WINDOW_STATS_CONF_SLOTS
+#else
+#define WINDOW_STATS_SLOTS 5
+#endif
+
+#ifdef WINDOW_STATS_CONF_SLOT_DURATION
+#define WINDOW_STATS_SLOT_DURATION WINDOW_STATS_CONF_SLOT_DURATION
+#else
+#define WINDOW_STATS_SLOT_DURATION (CLOCK_SECOND * 60)
+#endif
+
+/* Weight of a new sample in the moving averages: 1/2^WINDOW_STATS_EWMA_SHIFT */
+#ifdef WINDOW_STATS_CONF_EWMA_SHIFT
+#define WINDOW_STATS_EWMA_SHIFT WINDOW_STATS_CONF_EWMA_SHIFT
+#else
+#define WINDOW_STATS_EWMA_SHIFT 3
+#endif
+
+#define WINDOW_STATS_FRAC_BITS 8
+
+/* Returned when there is nothing to compute a ratio from */
+#define WINDOW_STATS_UNKNOWN 0xffff
+
+/* Counts of one slot of the window */
+typedef struct {
+  uint16_t sent;            // Reports the node sent
+  uint16_t received;        // Reports received
+  uint16_t pings;           // PINGs the node sent
+  uint16_t pongs;           // PONGs the node received
+} window_stats_slot_t;
+
+typedef struct {
+  window_stats_slot_t slots[WINDOW_STATS_SLOTS];
+  clock_time_t slot_start;  // When the current slot started
+  uint8_t current;          // Slot being filled
+  uint8_t reports;          // Reports seen, saturating; 0 if none yet
+  uint16_t tx_count;        // Counters of the node at its previous report
+  uint16_t ping_sent;
+  uint16_t pong_received;
+  int32_t prr;              // Moving averages, WINDOW_STATS_FRAC_BITS fractional bits
+  int32_t loss;             // Percent
+  int32_t rtt;              // ms
+  int32_t rssi;             // dBm
+} window_stats_t;
+
+/* Start with an empty window */
+void window_stats_init(window_stats_t *w);
+
+/* Account a report received with the given RSSI */
+void window_stats_update(window_stats_t *w, const telemetry_sensor_t *report,
+                         int16_t rssi);
+
+/* PRR and PING loss over the window, in percent, or WINDOW_STATS_UNKNOWN */
+uint16_t window_stats_prr(window_stats_t *w);
+uint16_t window_stats_loss(window_stats_t *w);
+
+/* Integer part of a moving average */
+#define WINDOW_STATS_AVERAGE(x) ((int)((x) / (1 << WINDOW_STATS_FRAC_BITS)))
+
+#endif /* WINDOW_STATS_H_ */